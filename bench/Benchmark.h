@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+// Minimal timing harness for the microbenchmarks.
+// Runs a body once to warm up (caches, lazily started scheduler threads), then `Runs` more times,
+// and prints and returns the median wall time in milliseconds.
+namespace Benchmark {
+inline constexpr int Runs = 15;
+
+// `setup` runs before each run of `body`, untimed.
+template<typename Setup, typename Body> double Run(const char *name, Setup &&setup, Body &&body) {
+    using Clock = std::chrono::steady_clock;
+    setup();
+    body();
+    std::vector<double> times_ms(Runs);
+    for (auto &time_ms : times_ms) {
+        setup();
+        const auto start = Clock::now();
+        body();
+        time_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    std::nth_element(times_ms.begin(), times_ms.begin() + Runs / 2, times_ms.end());
+    const double median_ms = times_ms[Runs / 2];
+    std::printf("%-44s %10.3f ms\n", name, median_ms);
+    return median_ms;
+}
+template<typename Body> double Run(const char *name, Body &&body) {
+    return Run(name, [] {}, std::forward<Body>(body));
+}
+
+inline void PrintSpeedup(double baseline_ms, double ms) { std::printf("%-44s %10.2fx\n", "Speedup", baseline_ms / ms); }
+} // namespace Benchmark
@@ -0,0 +1,54 @@
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Geometry/Geometry.h"
+
+// The Flat mode buffers as they were filled before `Geometry` preallocated them and filled each face's corners in parallel:
+// one thread, appending every corner to growing vectors.
+struct FlatBuffers {
+    std::vector<glm::vec3> Vertices, Normals;
+    std::vector<uint> Indices;
+};
+static FlatBuffers FillFlatBuffersSerial(const Geometry::MeshType &mesh) {
+    FlatBuffers buffers;
+    for (const auto &fh : mesh.faces()) {
+        for (const auto &vh : mesh.fv_range(fh)) {
+            const auto &p = mesh.point(vh);
+            buffers.Vertices.emplace_back(p[0], p[1], p[2]);
+        }
+    }
+    for (const auto &fh : mesh.faces()) {
+        const auto &n = mesh.normal(fh);
+        for (size_t i = 0; i < mesh.valence(fh); ++i) buffers.Normals.emplace_back(n[0], n[1], n[2]);
+    }
+    size_t num_triangles = 0;
+    for (const auto &fh : mesh.faces()) num_triangles += mesh.valence(fh) - 2;
+    buffers.Indices.reserve(num_triangles * 3);
+    uint index = 0;
+    for (const auto &fh : mesh.faces()) {
+        const auto valence = mesh.valence(fh);
+        for (uint i = 0; i < valence - 2; ++i) buffers.Indices.insert(buffers.Indices.end(), {index, index + i + 1, index + i + 2});
+        index += valence;
+    }
+    return buffers;
+}
+
+// Switches a mesh to Flat mode, which fills its vertex, normal and index buffers, and compares with the serial fill.
+// Usage: benchmark_geometry [path]
+int main(int argc, char **argv) {
+    const fs::path path = argc > 1 ? fs::path(argv[1]) : fs::path("res") / "obj" / "bunny.obj";
+    Geometry geometry;
+    if (!geometry.Load(path)) return 1;
+
+    std::printf("%s: %u vertices, %u faces\n", path.string().c_str(), geometry.NumVertices(), geometry.NumFaces());
+
+    const double serial_ms = Benchmark::Run("Flat buffers, serial append", [&] { FillFlatBuffersSerial(geometry.GetMesh()); });
+    const double parallel_ms = Benchmark::Run(
+        "Geometry::PrepareRender(RenderMode::Flat)",
+        [&] { geometry.PrepareRender(RenderMode::Smooth); },
+        [&] { geometry.PrepareRender(RenderMode::Flat); }
+    );
+    Benchmark::PrintSpeedup(serial_ms, parallel_ms);
+    return 0;
+}
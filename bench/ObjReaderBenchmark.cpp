@@ -0,0 +1,30 @@
+#include <cstdio>
+#include <stdexcept>
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+#include <OpenMesh/Core/Mesh/PolyMesh_ArrayKernelT.hh>
+
+#include "Benchmark.h"
+#include "Geometry/ObjReader.h"
+
+// Reads an OBJ file with the parallel `ObjReader`, and with OpenMesh's reader, which loaded every format before it.
+// Usage: benchmark_obj_reader [path.obj]
+// Large (e.g. scanned) meshes show the difference best. The default mesh only has a few thousand faces.
+int main(int argc, char **argv) {
+    const fs::path path = argc > 1 ? fs::path(argv[1]) : fs::path("res") / "obj" / "bunny.obj";
+    try {
+        const auto polygons = ObjReader::Read(path);
+        std::printf("%s: %zu points, %zu faces\n", path.string().c_str(), polygons.Points.size(), polygons.FaceSizes.size());
+
+        const double openmesh_ms = Benchmark::Run("OpenMesh::IO::read_mesh", [&] {
+            OpenMesh::PolyMesh_ArrayKernelT<> mesh;
+            if (!OpenMesh::IO::read_mesh(mesh, path.string())) throw std::runtime_error("OpenMesh failed to read " + path.string());
+        });
+        const double obj_reader_ms = Benchmark::Run("ObjReader::Read", [&] { ObjReader::Read(path); });
+        Benchmark::PrintSpeedup(openmesh_ms, obj_reader_ms);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/vec4.hpp>
+
+#include "Benchmark.h"
+#include "Geometry/ScreenProjection.h"
+
+// Nearest visible point within `radius` pixels, projecting one `glm::vec3` at a time, as hovering did before `ScreenProjection`.
+static int FindNearestWithinPerPoint(const std::vector<glm::vec3> &points, const glm::mat4 &mvp, glm::vec2 viewport_size, glm::vec2 screen_point, float radius) {
+    int nearest = -1;
+    float nearest_depth = 0;
+    for (uint i = 0; i < points.size(); ++i) {
+        const glm::vec4 clip = mvp * glm::vec4(points[i], 1);
+        if (clip.w <= 0 || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w || std::abs(clip.z) > clip.w) continue;
+
+        const float half_inv_w = 0.5f / clip.w;
+        const glm::vec2 screen{(0.5f + clip.x * half_inv_w) * viewport_size.x, (0.5f - clip.y * half_inv_w) * viewport_size.y};
+        const glm::vec2 delta = screen - screen_point;
+        if (delta.x * delta.x + delta.y * delta.y <= radius * radius && (nearest == -1 || clip.w < nearest_depth)) {
+            nearest = i;
+            nearest_depth = clip.w;
+        }
+    }
+    return nearest;
+}
+
+// Written by every timed query, so the compiler can't drop queries with unused results.
+static volatile int PickedVertex;
+
+// Hover queries over random points in view, with and without the batched kernel.
+// Usage: benchmark_screen_projection [num_points]
+int main(int argc, char **argv) {
+    const uint num_points = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> coordinate(-1, 1);
+    std::vector<glm::vec3> points(num_points);
+    for (auto &point : points) point = {coordinate(rng), coordinate(rng), coordinate(rng)};
+
+    const glm::vec2 viewport_size{1280, 720};
+    const glm::mat4 mvp = glm::perspective(glm::radians(60.f), viewport_size.x / viewport_size.y, 0.1f, 100.f) *
+        glm::lookAt(glm::vec3{0, 0, 4}, glm::vec3{0, 0, 0}, glm::vec3{0, 1, 0});
+    std::uniform_real_distribution<float> screen_x(0, viewport_size.x), screen_y(0, viewport_size.y);
+    std::vector<glm::vec2> queries(64);
+    for (auto &query : queries) query = {screen_x(rng), screen_y(rng)};
+    static constexpr float Radius = 8;
+
+    std::printf("%u points, %zu hover queries per run\n", num_points, queries.size());
+
+    int mismatches = 0;
+    const ScreenProjection::Points batched_points{points};
+    for (const auto &query : queries) {
+        if (FindNearestWithinPerPoint(points, mvp, viewport_size, query, Radius) != ScreenProjection::FindNearestWithin(batched_points, mvp, viewport_size, query, Radius)) ++mismatches;
+    }
+    // Rounding differences can pick a different point at equal depth, so a rare mismatch isn't a bug.
+    if (mismatches > 0) std::printf("%d of %zu queries picked a different point\n", mismatches, queries.size());
+
+    const double per_point_ms = Benchmark::Run("Per-point glm projection", [&] {
+        for (const auto &query : queries) PickedVertex = FindNearestWithinPerPoint(points, mvp, viewport_size, query, Radius);
+    });
+    const double batched_ms = Benchmark::Run("ScreenProjection::FindNearestWithin", [&] {
+        for (const auto &query : queries) PickedVertex = ScreenProjection::FindNearestWithin(batched_points, mvp, viewport_size, query, Radius);
+    });
+    Benchmark::PrintSpeedup(per_point_ms, batched_ms);
+    return 0;
+}
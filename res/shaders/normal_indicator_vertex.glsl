@@ -0,0 +1,20 @@
+#version 330 core
+
+// Draws one line per instance, from a vertex position (or face center) along its normal.
+// Vertex 0 is the base of the line, and vertex 1 is its tip.
+
+uniform mat4 camera_view;
+uniform mat4 projection;
+uniform mat4 model;
+uniform float normal_length; // World units
+
+layout (location = 0) in vec3 Pos;
+layout (location = 1) in vec3 Normal;
+
+void main() {
+    vec4 position = model * vec4(Pos, 1.0);
+    vec3 normal = normalize(mat3(transpose(inverse(model))) * Normal);
+    if (gl_VertexID == 1) position.xyz += normal * normal_length * position.w;
+
+    gl_Position = projection * camera_view * position;
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+flat in uint frag_in_id;
+
+out uint pick_id;
+
+void main() {
+    // Points are rasterized as squares. Keep the disc.
+    vec2 offset = gl_PointCoord - vec2(0.5);
+    if (dot(offset, offset) > 0.25) discard;
+
+    pick_id = frag_in_id;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+
+// Draws each vertex as a point disc, with its (1-based) vertex index as the ID.
+// Points are depth-tested, so the vertex nearest to the camera wins where discs overlap.
+
+uniform mat4 camera_view;
+uniform mat4 projection;
+uniform mat4 model;
+uniform float point_size; // Disc diameter (pixels)
+
+layout (location = 0) in vec3 Pos;
+
+flat out uint frag_in_id;
+
+void main() {
+    gl_Position = projection * camera_view * model * vec4(Pos, 1.0);
+    gl_PointSize = point_size;
+    frag_in_id = uint(gl_VertexID) + 1u; // 0 is cleared to, and means no vertex.
+}
@@ -5,6 +5,8 @@
 
 uniform mat4 camera_view;
 uniform mat4 projection;
+uniform int highlight_instance; // Instance drawn with `highlight_color` instead of its own color. -1 for none.
+uniform vec4 highlight_color;
 
 layout (location = 0) in vec3 Pos;
 layout (location = 1) in vec3 Normal;
@@ -18,7 +20,7 @@ out vec4 frag_in_color;
 void main() {
     frag_in_position = Transform * vec4(Pos, 1.0);
     frag_in_normal = mat3(transpose(inverse(Transform))) * Normal;
-    frag_in_color = Color;
+    frag_in_color = gl_InstanceID == highlight_instance ? highlight_color : Color;
 
     gl_Position = projection * camera_view * frag_in_position;
 }
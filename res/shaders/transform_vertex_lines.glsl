@@ -5,6 +5,8 @@
 
 uniform mat4 camera_view;
 uniform mat4 projection;
+uniform int highlight_instance; // Instance drawn with `highlight_color` instead of its own color. -1 for none.
+uniform vec4 highlight_color;
 
 layout (location = 0) in vec3 Pos;
 layout (location = 1) in vec3 Normal;
@@ -18,7 +20,7 @@ out vec4 vertex_color;
 void main() {
     vertex_position = Transform * vec4(Pos, 1.0);
     vertex_normal = mat3(transpose(inverse(Transform))) * Normal;
-    vertex_color = Color;
+    vertex_color = gl_InstanceID == highlight_instance ? highlight_color : Color;
 
     gl_Position = projection * camera_view * vertex_position;
 }
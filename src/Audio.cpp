@@ -1,7 +1,11 @@
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <filesystem>
 #include <format>
 #include <locale>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string_view>
@@ -22,6 +26,8 @@ using Sample = float;
 
 #include "Audio.h"
 #include "FaustParams.h"
+#include "ModalSynth.h"
+#include "RealtimeCheck.h"
 
 using std::string_view, std::vector;
 
@@ -70,25 +76,162 @@ process = hammer(gate,hammerHardness,hammerSize),_ : select2(source) : modalMode
 }
 
 namespace FaustContext {
-using State = Audio::FaustState;
+// A compiled and initialized Faust instrument.
+struct Instance {
+    Instance(llvm_dsp_factory *factory, dsp *dsp, u32 sample_rate) : Factory(factory), Dsp(dsp), SampleRate(sample_rate) {}
+    ~Instance() {
+        delete Dsp;
+        deleteDSPFactory(Factory);
+    }
+
+    llvm_dsp_factory *Factory;
+    dsp *Dsp;
+    u32 SampleRate;
+    FaustParams Ui{};
+};
 
-static dsp *Dsp = nullptr;
-static std::unique_ptr<FaustParams> Ui;
+static constexpr u32 MaxBlockFrames = 512; // Voices compute in blocks of at most this many frames.
+static constexpr Sample SilenceThreshold = 1e-5; // -100 dB
+static constexpr float SuspendAfterSeconds = 0.5; // Voices suspend after being silent and unexcited for this long.
+
+struct Voice {
+    string Code; // Set from the UI thread.
+    string Error; // Set by the update thread when compilation fails.
+    bool Removed = false; // Set from the UI thread. The voice is destroyed on the next update.
+
+    string CompiledCode; // The most recently compiled code, successfully or not.
+    std::unique_ptr<Instance> Running, Pending; // `Pending` is compiled while the device runs, and handed to the audio thread in `Swap`.
+    bool HasPending = false; // `Pending` can be null, meaning the running instance should be removed.
+
+    std::shared_ptr<const ModalModel> Model; // Set from the UI thread.
+    std::shared_ptr<const ModalModel> SynthModel; // The model of the most recently built synth.
+    std::unique_ptr<ModalSynth> Synth, PendingSynth; // Swapped in the same way as `Running`/`Pending`.
+    bool HasPendingSynth = false;
+    // Play the native synth rather than the Faust instrument when both are available.
+    // The synth also plays while the Faust instrument is being generated and compiled.
+    std::atomic<bool> UseSynth = true;
+
+    // These values point to the corresponding parameter zones of the running instance.
+    Sample *ExcitePos = nullptr, *ExciteValue = nullptr;
+    std::atomic<u32> ExciteCount = 0; // Incremented on every excitation, so the audio thread never misses a short one.
+    std::atomic<bool> Suspended = false; // Set by the audio thread.
+
+    ModalSynth *ActiveSynth() const { return Synth && (UseSynth || !Running) ? Synth.get() : nullptr; }
+};
 
-static void OnUiChange() {
-    OnUiChange(Ui.get());
-    if (Ui == nullptr) {
-        State::ExcitePos = nullptr;
-        State::ExciteValue = nullptr;
-    } else {
-        State::ExcitePos = Ui->getZoneForLabel("exPos");
-        State::ExciteValue = Ui->getZoneForLabel("gate");
+// The audio thread's view of a running voice.
+// Created on the update thread in `Swap`, and only accessed by the audio thread once handed over.
+struct VoicePlayback {
+    VoicePlayback(Voice &voice) : Owner(voice), Dsp(voice.Running.get()), Synth(voice.Synth.get()), ExciteValue(voice.ExciteValue) {
+        SeenExciteCount = voice.ExciteCount;
+        if (!Dsp) return;
+
+        const u32 num_outputs = Dsp->Dsp->getNumOutputs();
+        OutputBuffer.assign(num_outputs * MaxBlockFrames, 0);
+        Outputs.resize(num_outputs);
+        for (u32 channel = 0; channel < num_outputs; channel++) Outputs[channel] = OutputBuffer.data() + channel * MaxBlockFrames;
+        Inputs.resize(Dsp->Dsp->getNumInputs());
+        SuspendFrames = Dsp->SampleRate * SuspendAfterSeconds;
+    }
+
+    Voice &Owner; // Only its atomics are accessed from the audio thread.
+    Instance *Dsp;
+    ModalSynth *Synth;
+    const Sample *ExciteValue;
+
+    bool Suspended = false;
+    u32 SeenExciteCount = 0, QuietFrames = 0, SuspendFrames = 0;
+    vector<Sample> OutputBuffer;
+    vector<Sample *> Inputs, Outputs;
+
+    bool IsExcited() const { return ExciteValue && *ExciteValue != 0; }
+    ModalSynth *ActiveSynth() const { return Synth && (Owner.UseSynth || !Dsp) ? Synth : nullptr; }
+
+    // Mix `frame_count` frames of this voice into `out`, given the (mono) device input.
+    void Process(const Sample *in, Sample *out, u32 frame_count) {
+        const u32 excite_count = Owner.ExciteCount.load(std::memory_order_acquire);
+        const bool triggered = excite_count != SeenExciteCount;
+        SeenExciteCount = excite_count;
+        if (auto *synth = ActiveSynth()) {
+            // The synth tracks the energy of each of its modes, and skips modes (or everything) that are inaudible.
+            synth->Process(in, out, frame_count, triggered);
+            Owner.Suspended = Suspended = synth->IsIdle();
+            return;
+        }
+        if (!Dsp) return;
+
+        bool excited = triggered || IsExcited();
+        if (!excited && !Inputs.empty()) {
+            for (u32 i = 0; i < frame_count && !excited; i++) excited = std::abs(in[i]) > SilenceThreshold;
+        }
+        if (excited) {
+            Owner.Suspended = Suspended = false;
+            QuietFrames = 0;
+        }
+        if (Suspended) return;
+
+        const Sample scale = Sample(1) / Outputs.size(); // Mix all output channels down to mono.
+        for (u32 offset = 0; offset < frame_count; offset += MaxBlockFrames) {
+            const u32 block_frames = std::min(MaxBlockFrames, frame_count - offset);
+            // Faust `compute` expects a non-const buffer: https://github.com/grame-cncm/faust/pull/850
+            for (auto &input : Inputs) input = const_cast<Sample *>(in + offset);
+            Dsp->Dsp->compute(block_frames, Inputs.data(), Outputs.data());
+
+            Sample peak = 0;
+            for (const auto *channel : Outputs) {
+                for (u32 i = 0; i < block_frames; i++) {
+                    out[offset + i] += channel[i] * scale;
+                    peak = std::max(peak, std::abs(channel[i]));
+                }
+            }
+            QuietFrames = peak < SilenceThreshold ? QuietFrames + block_frames : 0;
+        }
+        if (QuietFrames >= SuspendFrames && !IsExcited()) Owner.Suspended = Suspended = true;
     }
+};
+
+// Everything the audio thread plays, handed over as a whole so voices can change without stopping the device.
+// Instances, synths and voices replaced while a set is playing are kept alive by it, and freed with it
+// once the audio thread has moved on to the next set.
+struct VoiceSet {
+    vector<VoicePlayback> Voices;
+    vector<std::unique_ptr<Instance>> RetiredInstances;
+    vector<std::unique_ptr<ModalSynth>> RetiredSynths;
+    vector<std::unique_ptr<Voice>> RetiredVoices;
+};
+
+// Guards `Voices` against concurrent access from the UI and update threads.
+// Never taken on the audio thread, which only sees `AudioSet`.
+static RealtimeCheck::Mutex Mutex;
+static std::map<u32, std::unique_ptr<Voice>> Voices;
+static u32 NextVoiceId = 0;
+static vector<Voice *> RunningVoices; // The voices in `PublishedSet`, for the UI.
+static bool IsLibContextCreated = false;
+
+// Voice set handoff. Only one handoff is in flight at a time.
+static std::unique_ptr<VoiceSet> PublishedSet; // The set the audio thread is playing, or will pick up on its next callback.
+static std::unique_ptr<VoiceSet> RetiringSet; // The set played before `PublishedSet`, freed once the audio thread picks that up.
+static std::atomic<VoiceSet *> NextSet = nullptr; // Set on the update thread, and cleared by the audio thread when it picks up the set.
+static VoiceSet *AudioSet = nullptr; // Only accessed by the audio thread, or while the device is stopped.
+
+// Frees the retiring set once the audio thread has acknowledged the handoff.
+// Returns `true` if no handoff is in flight.
+static bool CollectRetired() {
+    if (RetiringSet && NextSet.load(std::memory_order_acquire) == nullptr) RetiringSet.reset();
+    return !RetiringSet;
+}
+
+// Only called from the audio thread.
+static void PickUpNextSet() {
+    if (auto *next = NextSet.exchange(nullptr, std::memory_order_acq_rel)) AudioSet = next;
 }
 
-static void Init(State &faust, unsigned int sample_rate) {
-    createLibContext();
+static Voice *FindVoice(u32 id) {
+    const auto it = Voices.find(id);
+    return it != Voices.end() && !it->second->Removed ? it->second.get() : nullptr;
+}
 
+static std::unique_ptr<Instance> CreateInstance(const string &code, u32 sample_rate, string &error_msg) {
     string libraries_path = fs::relative("../lib/faust/libraries").string();
     vector<const char *> argv;
     argv.reserve(8);
@@ -97,84 +240,278 @@ static void Init(State &faust, unsigned int sample_rate) {
     if (std::is_same_v<Sample, double>) argv.push_back("-double");
 
     const int argc = argv.size();
-    static int num_inputs, num_outputs;
-    static string error_msg;
-    const Box box = DSPToBoxes("Mesh2Audio", faust.Code, argc, argv.data(), &num_inputs, &num_outputs, error_msg);
+    int num_inputs, num_outputs;
+    const Box box = DSPToBoxes("Mesh2Audio", code, argc, argv.data(), &num_inputs, &num_outputs, error_msg);
+    if (!box && error_msg.empty()) error_msg = "Incomplete Faust code.";
+    if (!box || !error_msg.empty()) return nullptr;
+
+    static const int optimize_level = -1;
+    llvm_dsp_factory *dsp_factory = createDSPFactoryFromBoxes("Mesh2Audio", box, argc, argv.data(), "", error_msg, optimize_level);
+    if (!dsp_factory) return nullptr;
+    if (!error_msg.empty()) {
+        deleteDSPFactory(dsp_factory);
+        return nullptr;
+    }
 
-    static llvm_dsp_factory *dsp_factory;
-    if (box && error_msg.empty()) {
-        static const int optimize_level = -1;
-        dsp_factory = createDSPFactoryFromBoxes("Mesh2Audio", box, argc, argv.data(), "", error_msg, optimize_level);
+    dsp *dsp = dsp_factory->createDSPInstance();
+    if (!dsp) {
+        error_msg = "Could not create Faust DSP.";
+        deleteDSPFactory(dsp_factory);
+        return nullptr;
     }
-    if (!box && error_msg.empty()) error_msg = "Incomplete Faust code.";
+    dsp->init(sample_rate);
+    auto instance = std::make_unique<Instance>(dsp_factory, dsp, sample_rate);
+    dsp->buildUserInterface(&instance->Ui);
+    return instance;
+}
 
-    if (dsp_factory && error_msg.empty()) {
-        Dsp = dsp_factory->createDSPInstance();
-        if (!Dsp) error_msg = "Could not create Faust DSP.";
-        else {
-            Dsp->init(sample_rate);
-            Ui = std::make_unique<FaustParams>();
-            Dsp->buildUserInterface(Ui.get());
+// Compiles voices whose code has changed, without touching anything the audio thread can see.
+// Returns `true` if `Swap` needs to be called.
+static bool Compile(u32 sample_rate, string *status_out) {
+    bool needs_swap = false;
+    vector<std::pair<u32, string>> to_compile;
+    vector<std::pair<u32, std::shared_ptr<const ModalModel>>> to_build;
+    {
+        std::lock_guard lock(Mutex);
+        for (auto &[id, voice] : Voices) {
+            if (voice->Removed) {
+                needs_swap = true;
+                continue;
+            }
+            if ((voice->Running && voice->Running->SampleRate != sample_rate) || (voice->Synth && voice->Synth->GetSampleRate() != sample_rate)) needs_swap = true;
+            if (voice->HasPending || voice->HasPendingSynth) needs_swap = true; // Left over from a deferred swap.
+            if (voice->Model != voice->SynthModel) to_build.emplace_back(id, voice->SynthModel = voice->Model);
+            if (voice->Code != voice->CompiledCode) to_compile.emplace_back(id, voice->CompiledCode = voice->Code);
         }
     }
+    for (const auto &[id, model] : to_build) {
+        auto synth = model ? std::make_unique<ModalSynth>(model, sample_rate) : nullptr;
+
+        std::lock_guard lock(Mutex);
+        if (auto *voice = FindVoice(id)) {
+            voice->PendingSynth = std::move(synth);
+            voice->HasPendingSynth = true;
+            needs_swap = true;
+        }
+    }
+    if (to_compile.empty()) return needs_swap;
 
-    if (!error_msg.empty()) faust.Error = error_msg;
-    else if (!faust.Error.empty()) faust.Error = "";
+    if (!IsLibContextCreated) {
+        createLibContext();
+        IsLibContextCreated = true;
+    }
+    (*status_out) = AudioStatusMessage::Compiling;
+    for (const auto &[id, code] : to_compile) {
+        string error_msg;
+        auto instance = code.empty() ? nullptr : CreateInstance(code, sample_rate, error_msg);
+
+        std::lock_guard lock(Mutex);
+        if (auto *voice = FindVoice(id)) {
+            voice->Pending = std::move(instance);
+            voice->HasPending = true;
+            voice->Error = error_msg;
+        }
+    }
+    return true;
+}
 
-    OnUiChange();
+// Swaps in compiled voices and retires removed ones, handing the new voice set to the audio thread.
+// Old instances are freed on a later update, once the audio thread has picked up the new set.
+// Returns `false` without doing anything if the previous handoff is still in flight. Try again on the next update.
+static bool Swap(u32 sample_rate, string *status_out, bool device_started) {
+    if (!device_started) {
+        // Nothing is playing, so any in-flight handoff can complete right away.
+        NextSet = nullptr;
+        AudioSet = PublishedSet.get();
+    }
+    if (!CollectRetired()) return false;
+
+    std::lock_guard lock(Mutex);
+    auto retiring = PublishedSet ? std::move(PublishedSet) : std::make_unique<VoiceSet>();
+    auto next = std::make_unique<VoiceSet>();
+    RunningVoices.clear();
+    for (auto it = Voices.begin(); it != Voices.end();) {
+        auto &voice = *it->second;
+        if (voice.Removed) {
+            retiring->RetiredVoices.push_back(std::move(it->second));
+            it = Voices.erase(it);
+            continue;
+        }
+        if (voice.HasPending) {
+            if (voice.Running) retiring->RetiredInstances.push_back(std::move(voice.Running));
+            voice.Running = std::move(voice.Pending);
+            voice.HasPending = false;
+            if (voice.Running) {
+                voice.ExcitePos = voice.Running->Ui.getZoneForLabel("exPos");
+                voice.ExciteValue = voice.Running->Ui.getZoneForLabel("gate");
+            } else {
+                voice.ExcitePos = voice.ExciteValue = nullptr;
+            }
+            voice.Suspended = false;
+        }
+        if (voice.HasPendingSynth) {
+            if (voice.Synth) retiring->RetiredSynths.push_back(std::move(voice.Synth));
+            voice.Synth = std::move(voice.PendingSynth);
+            voice.HasPendingSynth = false;
+            voice.Suspended = false;
+        }
+        // Sample rate changes restart the device, so these only happen while it's stopped.
+        if (voice.Synth && voice.Synth->GetSampleRate() != sample_rate) voice.Synth->SetSampleRate(sample_rate);
+        if (voice.Running && voice.Running->SampleRate != sample_rate) {
+            voice.Running->Dsp->init(sample_rate);
+            voice.Running->SampleRate = sample_rate;
+        }
+        if (voice.Running || voice.Synth) {
+            next->Voices.emplace_back(voice);
+            RunningVoices.push_back(&voice);
+        }
+        ++it;
+    }
+
+    PublishedSet = std::move(next);
+    if (device_started) {
+        RetiringSet = std::move(retiring);
+        NextSet.store(PublishedSet.get(), std::memory_order_release);
+    } else {
+        AudioSet = PublishedSet.get();
+    }
+    (*status_out) = RunningVoices.empty() ? AudioStatusMessage::NoDsp : AudioStatusMessage::Running;
+    return true;
 }
 
+// Only called after the device is destroyed.
 static void Destroy() {
-    Ui = nullptr;
-    OnUiChange();
-
-    if (Dsp) {
-        delete Dsp;
-        Dsp = nullptr;
-        deleteAllDSPFactories(); // There should only be one factory, but using this instead of `deleteDSPFactory` avoids storing another file-scoped variable.
+    std::lock_guard lock(Mutex);
+    AudioSet = nullptr;
+    NextSet = nullptr;
+    RetiringSet.reset();
+    PublishedSet.reset();
+    RunningVoices.clear();
+    Voices.clear();
+    if (IsLibContextCreated) {
+        destroyLibContext();
+        IsLibContextCreated = false;
     }
+}
+} // namespace FaustContext
+
+using FaustContext::Mutex;
 
-    destroyLibContext();
+u32 Audio::FaustState::CreateVoice() {
+    std::lock_guard lock(Mutex);
+    const u32 id = FaustContext::NextVoiceId++;
+    FaustContext::Voices.emplace(id, std::make_unique<FaustContext::Voice>());
+    return id;
 }
 
-static bool NeedsRestart(const State &faust, u32 sample_rate) {
-    static string PreviousFaustCode = faust.Code;
-    static u32 PreviousSampleRate = sample_rate;
+void Audio::FaustState::DestroyVoice(u32 id) {
+    std::lock_guard lock(Mutex);
+    if (auto *voice = FaustContext::FindVoice(id)) voice->Removed = true;
+}
 
-    const bool needs_restart = faust.Code != PreviousFaustCode || sample_rate != PreviousSampleRate;
-    PreviousFaustCode = faust.Code;
-    PreviousSampleRate = sample_rate;
-    return needs_restart;
+string Audio::FaustState::GetCode(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return voice ? voice->Code : "";
 }
 
-// Returns true if recompiled.
-static bool Update(State &faust, u32 sample_rate, string *status_out) {
-    // Faust setup is only dependent on the faust code.
-    const bool is_faust_initialized = !faust.Code.empty() && faust.Error.empty();
-    const bool faust_needs_restart = NeedsRestart(faust, sample_rate); // Don't inline! Must run during every update.
+void Audio::FaustState::SetCode(u32 id, string code) {
+    std::lock_guard lock(Mutex);
+    if (auto *voice = FaustContext::FindVoice(id)) voice->Code = std::move(code);
+}
 
-    bool recompiled = false;
-    if (!Dsp && is_faust_initialized) {
-        (*status_out) = AudioStatusMessage::Compiling;
-        Init(faust, sample_rate);
-        recompiled = true;
-    } else if (Dsp && !is_faust_initialized) {
-        Destroy();
-    } else if (faust_needs_restart) {
-        Destroy();
-        (*status_out) = AudioStatusMessage::Compiling;
-        Init(faust, sample_rate);
-        recompiled = true;
+std::shared_ptr<const ModalModel> Audio::FaustState::GetModel(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return voice ? voice->Model : nullptr;
+}
+
+void Audio::FaustState::SetModel(u32 id, std::shared_ptr<const ModalModel> model) {
+    std::lock_guard lock(Mutex);
+    if (auto *voice = FaustContext::FindVoice(id)) voice->Model = std::move(model);
+}
+
+bool Audio::FaustState::UsesNativeSynth(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return !voice || voice->UseSynth;
+}
+
+string Audio::FaustState::GetError(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return voice ? voice->Error : "";
+}
+
+bool Audio::FaustState::IsRunning(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return voice && (voice->Running || voice->Synth);
+}
+
+bool Audio::FaustState::IsSuspended(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    return voice && voice->Suspended;
+}
+
+std::optional<Audio::FaustState::ExciteState> Audio::FaustState::GetExciteState(u32 id) {
+    std::lock_guard lock(Mutex);
+    const auto *voice = FaustContext::FindVoice(id);
+    if (!voice) return {};
+    if (const auto *synth = voice->ActiveSynth()) return ExciteState{synth->Params.ExcitePos.load(std::memory_order_relaxed), synth->Params.Gate.load(std::memory_order_relaxed)};
+    if (!voice->ExcitePos || !voice->ExciteValue) return {};
+    return ExciteState{int(*voice->ExcitePos), *voice->ExciteValue};
+}
+
+// Excite both engines, so switching between them doesn't lose the excitation state.
+void Audio::FaustState::Excite(u32 id, int excite_pos, float value) {
+    std::lock_guard lock(Mutex);
+    auto *voice = FaustContext::FindVoice(id);
+    if (!voice || (!voice->Synth && (!voice->ExcitePos || !voice->ExciteValue))) return;
+
+    if (voice->Synth) {
+        // Publish the position before the gate, so the audio thread never strikes the old position.
+        voice->Synth->Params.ExcitePos.store(excite_pos, std::memory_order_relaxed);
+        voice->Synth->Params.Gate.store(value, std::memory_order_release);
+    }
+    if (voice->ExcitePos && voice->ExciteValue) {
+        *voice->ExcitePos = excite_pos;
+        *voice->ExciteValue = value;
     }
-    if (Dsp) (*status_out) = AudioStatusMessage::Running;
-    else (*status_out) = AudioStatusMessage::NoDsp;
+    voice->ExciteCount.fetch_add(1, std::memory_order_release);
+}
 
-    return recompiled;
+void Audio::FaustState::Release(u32 id) {
+    std::lock_guard lock(Mutex);
+    auto *voice = FaustContext::FindVoice(id);
+    if (!voice) return;
+    if (voice->Synth) voice->Synth->Params.Gate.store(0, std::memory_order_release);
+    if (voice->ExciteValue) *voice->ExciteValue = 0;
+}
+
+u32 Audio::FaustState::NumRunningVoices() {
+    std::lock_guard lock(Mutex);
+    return FaustContext::RunningVoices.size();
+}
+
+u32 Audio::FaustState::NumActiveVoices() {
+    std::lock_guard lock(Mutex);
+    return std::count_if(FaustContext::RunningVoices.begin(), FaustContext::RunningVoices.end(), [](const auto *voice) { return !voice->Suspended; });
 }
-} // namespace FaustContext
 
-bool Audio::FaustState::IsRunning() {
-    return FaustContext::Dsp != nullptr;
+void Audio::FaustState::Render(u32 id) const {
+    std::lock_guard lock(Mutex);
+    auto *voice = FaustContext::FindVoice(id);
+    if (!voice) return;
+
+    if (voice->Synth) {
+        bool use_synth = voice->UseSynth;
+        if (ImGui::Checkbox("Native synth", &use_synth)) voice->UseSynth = use_synth;
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Play the modal model natively, skipping inaudible modes, rather than with the Faust instrument.\nThe Faust instrument is generated and compiled when first selected.");
+    }
+    if (auto *synth = voice->ActiveSynth()) synth->RenderParams();
+    else if (voice->Running) RenderFaustParams(voice->Running->Ui);
 }
 
 static ma_context AudioContext;
@@ -185,11 +522,15 @@ static ma_audio_buffer_ref InputBuffer;
 static ma_node_graph NodeGraph;
 static ma_node_graph_config NodeGraphConfig;
 static ma_node *OutputNode;
-static ma_node_base FaustNode{};
+static ma_node_base VoicesNode{}; // Mixes all running voices.
 static ma_data_source_node InputNode{};
 
 static ma_encoder_config WavEncoderConfig;
 static ma_encoder WavEncoder;
+static std::atomic<bool> IsEncoderInitialized = false; // Set on the UI thread when recording starts, cleared on the update thread when the file is closed.
+// The audio callback writes recorded frames here, and the update thread drains them into `WavEncoder`,
+// so that file I/O never happens on the audio thread.
+static ma_pcm_rb RecordBuffer;
 
 enum IO_ {
     IO_None = -1,
@@ -206,8 +547,10 @@ const vector<u32> PrioritizedSampleRates = {std::begin(g_maStandardSampleRatePri
 static vector<ma_format> NativeFormats;
 static vector<u32> NativeSampleRates;
 
+// Device/graph/DSP changes are polled on a dedicated thread rather than the shared scheduler,
+// so long-running background jobs can never delay them.
 static std::thread UpdateWorker;
-static std::atomic<bool> UpdateWorkerRunning = false;
+static std::atomic<bool> UpdateRunning = false;
 
 static const ma_device_id *GetDeviceId(IO io, string_view device_name) {
     for (const ma_device_info *info : DeviceInfos[io]) {
@@ -216,21 +559,39 @@ static const ma_device_id *GetDeviceId(IO io, string_view device_name) {
     return nullptr;
 }
 
+// Everything reachable from here runs on the audio thread, and must not allocate, lock, or do I/O.
+// Build with `REALTIME_SAFETY_CHECK` to catch violations.
 void DataCallback(ma_device *device, void *output, const void *input, ma_uint32 frame_count) {
+    RealtimeCheck::Scope realtime_scope;
+
     ma_audio_buffer_ref_set_data(&InputBuffer, input, frame_count);
     ma_node_graph_read_pcm_frames(&NodeGraph, output, frame_count, nullptr);
 
     if (Audio::AudioDevice::IsRecording) {
-        ma_encoder_write_pcm_frames(&WavEncoder, output, frame_count, nullptr);
+        // Frames that don't fit (if the update thread falls behind) are dropped.
+        const ma_uint32 channels = device->playback.channels;
+        ma_uint32 frames_written = 0;
+        while (frames_written < frame_count) {
+            ma_uint32 frames_to_write = frame_count - frames_written;
+            void *write_buffer;
+            if (ma_pcm_rb_acquire_write(&RecordBuffer, &frames_to_write, &write_buffer) != MA_SUCCESS || frames_to_write == 0) break;
+
+            memcpy(write_buffer, (const float *)output + frames_written * channels, frames_to_write * channels * sizeof(float));
+            ma_pcm_rb_commit_write(&RecordBuffer, frames_to_write);
+            frames_written += frames_to_write;
+        }
     }
-    (void)device; // unused
 }
 
-void FaustProcess(ma_node *node, const float **const_bus_frames_in, ma_uint32 *frame_count_in, float **bus_frames_out, ma_uint32 *frame_count_out) {
-    // ma_pcm_rb_init_ex()
-    // ma_deinterleave_pcm_frames()
-    float **bus_frames_in = const_cast<float **>(const_bus_frames_in); // Faust `compute` expects a non-const buffer: https://github.com/grame-cncm/faust/pull/850
-    if (FaustContext::Dsp) FaustContext::Dsp->compute(*frame_count_out, bus_frames_in, bus_frames_out);
+// Input and output buses are mono.
+void VoicesProcess(ma_node *node, const float **bus_frames_in, ma_uint32 *frame_count_in, float **bus_frames_out, ma_uint32 *frame_count_out) {
+    const u32 frame_count = *frame_count_out;
+    float *out = bus_frames_out[0];
+    std::fill_n(out, frame_count, 0.f);
+    FaustContext::PickUpNextSet();
+    if (auto *set = FaustContext::AudioSet) {
+        for (auto &voice : set->Voices) voice.Process(bus_frames_in[0], out, frame_count);
+    }
 
     (void)node; // unused
     (void)frame_count_in; // unused
@@ -260,21 +621,22 @@ void Audio::Init() {
         DeviceNames[IO_Out].push_back(PlaybackDeviceInfos[i].name);
     }
 
+    RealtimeCheck::Init();
     Device.Init();
-    FaustContext::Update(Faust, Device.SampleRate, &Status);
+    FaustContext::Compile(Device.SampleRate, &Status);
+    FaustContext::Swap(Device.SampleRate, &Status, false);
     Graph.Init();
     Device.Start();
 
     NeedsRestart(); // xxx Updates cached values as side effect.
 
-    Status = AudioStatusMessage::Running;
     Update();
 }
 
 void Audio::Destroy() {
     Device.Stop();
+    Device.Destroy(); // Flushes any in-progress recording, so must come before the graph (which owns the record buffer) is destroyed.
     Graph.Destroy();
-    Device.Destroy();
 
     const int result = ma_context_uninit(&AudioContext);
     if (result != MA_SUCCESS) throw std::runtime_error(std::format("Error shutting down audio context: {}", result));
@@ -283,26 +645,29 @@ void Audio::Destroy() {
 }
 
 void Audio::Run() {
-    UpdateWorkerRunning = true;
-    UpdateWorker = std::thread([&]() {
-        while (UpdateWorkerRunning) {
-            Update();
+    UpdateRunning = true;
+    UpdateWorker = std::thread([this] {
+        while (UpdateRunning) {
+            try {
+                Update();
+            } catch (const std::runtime_error &e) {
+                std::cerr << "Error: " << e.what() << '\n';
+            }
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        FaustContext::Destroy();
         Destroy();
+        FaustContext::Destroy();
     });
 }
 
 void Audio::Stop() {
-    UpdateWorkerRunning = false;
-    UpdateWorker.join();
+    UpdateRunning = false;
+    if (UpdateWorker.joinable()) UpdateWorker.join();
 }
 
 void Audio::Update() {
     const bool is_initialized = Device.IsStarted();
-    const bool faust_recompiled = is_initialized && FaustContext::Update(Faust, Device.SampleRate, &Status);
-    const bool needs_restart = faust_recompiled || NeedsRestart(); // Don't inline! Must run during every update.
+    const bool needs_restart = NeedsRestart(); // Don't inline! Must run during every update.
     if (Device.On && !is_initialized) {
         Init();
     } else if (!Device.On && is_initialized) {
@@ -310,11 +675,16 @@ void Audio::Update() {
     } else if (needs_restart && is_initialized) {
         Destroy();
         Init();
+    } else if (is_initialized && FaustContext::Compile(Device.SampleRate, &Status)) {
+        // Hand the new voices to the running audio thread. Replaced DSPs are freed once it lets go of them.
+        FaustContext::Swap(Device.SampleRate, &Status, true);
     }
+    FaustContext::CollectRetired();
     if (Device.IsStarted()) {
+        Device.FlushRecording();
         // Not working? Setting Faust node volume instead.
         // ma_device_set_master_volume(&MaDevice, Volume);
-        ma_node_set_output_bus_volume(&FaustNode, 0, Device.Muted ? 0.0f : Device.Volume);
+        ma_node_set_output_bus_volume(&VoicesNode, 0, Device.Muted ? 0.0f : Device.Volume);
     }
 }
 
@@ -371,23 +741,37 @@ void Audio::AudioDevice::Init() {
 }
 
 void Audio::AudioDevice::StartRecording() const {
-    if (IsRecording) return;
+    if (IsRecording || IsEncoderInitialized) return;
 
-    WavEncoderConfig = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, 1, SampleRate);
+    WavEncoderConfig = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, MaDevice.playback.channels, SampleRate);
     const string wav_filename = std::format("{}-{}.wav", "recording", std::time(nullptr));
     if (ma_encoder_init_file(wav_filename.c_str(), &WavEncoderConfig, &WavEncoder) != MA_SUCCESS) {
         throw std::runtime_error(std::format("Failed to initialize output file {}", wav_filename));
     }
+    ma_pcm_rb_reset(&RecordBuffer);
+    IsEncoderInitialized = true;
     IsRecording = true;
 }
 
-void Audio::AudioDevice::StopRecording() const {
-    if (!IsRecording) return;
+// The file is closed by the next `FlushRecording`, after the remaining buffered frames are written.
+void Audio::AudioDevice::StopRecording() const { IsRecording = false; }
+
+void Audio::AudioDevice::FlushRecording() const {
+    if (!IsEncoderInitialized) return;
 
-    IsRecording = false;
-    // Janky - sleep for a bit to make sure the encoder has finished writing to the file.
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    ma_encoder_uninit(&WavEncoder);
+    const bool stopped = !IsRecording; // Read before draining, so no frames written before stopping are missed.
+    ma_uint32 frames_to_read;
+    void *read_buffer;
+    while ((frames_to_read = ma_pcm_rb_available_read(&RecordBuffer)) > 0) {
+        if (ma_pcm_rb_acquire_read(&RecordBuffer, &frames_to_read, &read_buffer) != MA_SUCCESS || frames_to_read == 0) break;
+
+        ma_encoder_write_pcm_frames(&WavEncoder, read_buffer, frames_to_read, nullptr);
+        ma_pcm_rb_commit_read(&RecordBuffer, frames_to_read);
+    }
+    if (stopped) {
+        ma_encoder_uninit(&WavEncoder);
+        IsEncoderInitialized = false;
+    }
 }
 
 bool Audio::AudioDevice::IsStarted() const { return ma_device_is_started(&MaDevice); }
@@ -422,10 +806,6 @@ void Audio::Render() {
         TextUnformatted("Compiling...");
         return;
     }
-    if (!Faust.Error.empty()) {
-        TextUnformatted(Faust.Error.c_str());
-        return;
-    }
     if (Status == AudioStatusMessage::NoDsp) {
         TextUnformatted("No DSP");
         return;
@@ -435,7 +815,9 @@ void Audio::Render() {
         TextUnformatted("Stopped");
     } else if (Status == AudioStatusMessage::Running) {
         TextUnformatted("Running");
+        Text("Voices: %u (%u active)", FaustState::NumRunningVoices(), FaustState::NumActiveVoices());
     }
+    if (RealtimeCheck::Enabled) Text("Real-time violations: %u", RealtimeCheck::NumViolations());
     Device.Render();
 }
 
@@ -542,6 +924,7 @@ void Audio::AudioDevice::Render() {
 
 void Audio::AudioDevice::Destroy() {
     StopRecording();
+    FlushRecording();
     ma_device_uninit(&MaDevice);
 }
 
@@ -554,11 +937,16 @@ void Audio::AudioDevice::Stop() const {
     if (result != MA_SUCCESS) throw std::runtime_error(std::format("Error stopping audio device: {}", result));
 }
 
+// All buffers used by the audio callback are allocated here, before the device starts.
 void Audio::Graph::Init() {
     NodeGraphConfig = ma_node_graph_config_init(MaDevice.capture.channels);
     int result = ma_node_graph_init(&NodeGraphConfig, nullptr, &NodeGraph);
     if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize node graph: {}", result));
 
+    // One second of recording headroom. The update thread drains it every ~100ms.
+    result = ma_pcm_rb_init(ma_format_f32, MaDevice.playback.channels, MaDevice.sampleRate, nullptr, nullptr, &RecordBuffer);
+    if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize record buffer: {}", result));
+
     OutputNode = ma_node_graph_get_endpoint(&NodeGraph);
     result = ma_audio_buffer_ref_init(MaDevice.capture.format, MaDevice.capture.channels, nullptr, 0, &InputBuffer);
     if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize input audio buffer: {}", result));
@@ -568,29 +956,28 @@ void Audio::Graph::Init() {
     result = ma_data_source_node_init(&NodeGraph, &Config, nullptr, &InputNode);
     if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize the input node: {}", result));
 
-    if (FaustContext::Dsp) {
-        const u32 in_channels = FaustContext::Dsp->getNumInputs();
-        const u32 out_channels = FaustContext::Dsp->getNumOutputs();
-        if (in_channels == 0 && out_channels == 0) return;
+    // Voices are swapped in and out of the node (see `FaustContext::Swap`), so it exists even if there are no voices yet.
+    // Per-voice buffers are allocated when voices are swapped in, which also only happens while the device is stopped.
+    static const u32 in_channels = 1, out_channels = 1;
+    static ma_node_vtable vtable{};
+    vtable = {VoicesProcess, nullptr, 1, 1, 0};
 
-        static ma_node_vtable vtable{};
-        vtable = {FaustProcess, nullptr, ma_uint8(in_channels > 0 ? 1 : 0), ma_uint8(out_channels > 0 ? 1 : 0), 0};
+    static ma_node_config config;
+    config = ma_node_config_init();
+    config.pInputChannels = &in_channels;
+    config.pOutputChannels = &out_channels;
+    config.vtable = &vtable;
 
-        static ma_node_config config;
-        config = ma_node_config_init();
-        config.pInputChannels = &in_channels; // One input bus with N channels.
-        config.pOutputChannels = &out_channels; // One output bus with M channels.
-        config.vtable = &vtable;
-
-        const int result = ma_node_init(&NodeGraph, &config, nullptr, &FaustNode);
-        if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize the Faust node: {}", result));
-    }
+    result = ma_node_init(&NodeGraph, &config, nullptr, &VoicesNode);
+    if (result != MA_SUCCESS) throw std::runtime_error(std::format("Failed to initialize the voices node: {}", result));
 
-    ma_node_attach_output_bus(&FaustNode, 0, OutputNode, 0);
-    ma_node_attach_output_bus(&InputNode, 0, &FaustNode, 0);
+    ma_node_attach_output_bus(&VoicesNode, 0, OutputNode, 0);
+    ma_node_attach_output_bus(&InputNode, 0, &VoicesNode, 0);
 }
 
 void Audio::Graph::Destroy() {
+    ma_pcm_rb_uninit(&RecordBuffer);
+    ma_node_uninit(&VoicesNode, nullptr);
     ma_data_source_node_uninit(&InputNode, nullptr);
     ma_audio_buffer_ref_uninit(&InputBuffer);
     ma_node_graph_uninit(&NodeGraph, nullptr); // Graph endpoint is already uninitialized in `Nodes.Uninit`.
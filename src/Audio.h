@@ -1,11 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
 using std::string;
 using u32 = unsigned int;
 
+struct ModalModel;
+
 namespace AudioStatusMessage {
 static const string Initializing = "Initializing...";
 static const string Running = "Running";
@@ -15,18 +20,41 @@ static const string Stopped = "Stopped";
 } // namespace AudioStatusMessage
 
 struct Audio {
+    // Each sounding object owns a voice, playing its modal model with the native `ModalSynth`,
+    // and/or an instance of its own Faust instrument.
+    // All running voices are mixed into the audio output.
+    // Voices that have decayed to silence are suspended (not computed) until they are excited again.
+    // The native synth also skips individual modes that have decayed below audibility.
     struct FaustState {
-        string Code = "";
-        string Error;
-
-        // These values point to the corresponding Faust parameter zones.
-        inline static float *ExcitePos = nullptr;
-        inline static float *ExciteValue = nullptr;
-
-        void Render() const;
+        struct ExciteState {
+            int Pos; // Excitation position index.
+            float Value; // Gate value.
+        };
+
+        static u32 CreateVoice();
+        static void DestroyVoice(u32 voice_id);
+
+        static string GetCode(u32 voice_id);
+        static void SetCode(u32 voice_id, string code); // The voice is (re)compiled on the next audio update.
+        static string GetError(u32 voice_id);
+        static std::shared_ptr<const ModalModel> GetModel(u32 voice_id);
+        static void SetModel(u32 voice_id, std::shared_ptr<const ModalModel>); // The voice's synth is rebuilt on the next audio update.
+        // The native synth is selected, rather than the Faust instrument.
+        // Owners only need to generate the Faust code for their model once this is false.
+        static bool UsesNativeSynth(u32 voice_id);
+
+        static bool IsRunning(u32 voice_id);
+        static bool IsSuspended(u32 voice_id);
+        static std::optional<ExciteState> GetExciteState(u32 voice_id);
+        static void Excite(u32 voice_id, int excite_pos, float value); // No effect if the voice isn't running.
+        static void Release(u32 voice_id);
+
+        static u32 NumRunningVoices();
+        static u32 NumActiveVoices(); // Running and not suspended.
+
+        void Render(u32 voice_id) const; // Render the voice's parameter controls.
 
         static string GenerateModelInstrumentDsp(const std::string_view model_dsp, int num_excite_pos);
-        static bool IsRunning();
     };
 
     struct AudioDevice {
@@ -42,8 +70,12 @@ struct Audio {
 
         void StartRecording() const;
         void StopRecording() const;
+        // Writes recorded frames buffered by the audio callback to the output file,
+        // and closes the file if recording was stopped.
+        // Only call from the audio update thread.
+        void FlushRecording() const;
 
-        inline static bool IsRecording = false;
+        inline static std::atomic<bool> IsRecording = false;
 
         bool On = true;
         bool Muted = false;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// On-disk cache of expensive derived data (tet meshes etc.), keyed by a hash of everything the data depends on.
+namespace Cache {
+inline const fs::path Directory = "cache"; // Relative to the working directory, like other resource paths.
+
+// Incremental 64-bit FNV-1a hash of content. Not cryptographic, but plenty for cache keys.
+struct Hasher {
+    uint64_t Hash = 14695981039346656037ull;
+
+    Hasher &Add(std::span<const std::byte> bytes) {
+        for (const auto byte : bytes) Hash = (Hash ^ uint64_t(byte)) * 1099511628211ull;
+        return *this;
+    }
+    template<typename T> Hasher &Add(std::span<const T> values) { return Add(std::as_bytes(values)); }
+    template<typename T> Hasher &Add(const std::vector<T> &values) { return Add(std::span<const T>{values}); }
+    Hasher &Add(std::string_view str) { return Add(std::span<const char>{str.data(), str.size()}); }
+    template<typename T> requires std::is_arithmetic_v<T> Hasher &Add(T value) { return Add(std::span<const T>{&value, 1}); }
+};
+
+// Path of the cache entry of the given kind with the given key. Creates the kind's directory if needed.
+inline fs::path EntryPath(std::string_view kind, uint64_t key, std::string_view extension) {
+    const auto directory = Directory / kind;
+    fs::create_directories(directory);
+    return directory / std::format("{:016x}.{}", key, extension);
+}
+
+// Entries are written to a temporary file and renamed into place, so readers never see a partial entry.
+// The name is unique per process and write, so concurrent writers of the same entry never share a file.
+inline fs::path TempPath(const fs::path &entry) {
+    static std::atomic<uint32_t> NextTemp = 0;
+    return fs::path{entry}.concat(std::format(".{}-{}.tmp", getpid(), NextTemp++));
+}
+
+// Rename a fully written temporary file into place, or remove it if writing failed.
+// Failures are only reported, since the entry will just be rebuilt next time.
+inline void CommitEntry(const fs::path &temp_path, const fs::path &entry, bool written) {
+    std::error_code error;
+    if (written) {
+        fs::rename(temp_path, entry, error);
+        if (!error) return;
+        std::cerr << "Failed to write cache entry " << entry << ": " << error.message() << '\n';
+    }
+    fs::remove(temp_path, error);
+}
+} // namespace Cache
@@ -1,8 +1,6 @@
 #include "FaustParams.h"
 #include "imgui.h"
 
-#include "Audio.h"
-
 using namespace ImGui;
 
 FaustParams *interface;
@@ -80,12 +78,8 @@ void DrawUiItem(const FaustParams::Item &item) {
     }
 }
 
-void Audio::FaustState::Render() const {
-    if (!interface) return;
-
-    DrawUiItem(interface->ui);
-}
-
-void OnUiChange(FaustParams *ui) {
-    interface = ui;
+void RenderFaustParams(FaustParams &ui) {
+    interface = &ui;
+    DrawUiItem(ui.ui);
+    interface = nullptr;
 }
@@ -160,4 +160,4 @@ private:
     std::map<string, Real *> zone_for_label{};
 };
 
-void OnUiChange(FaustParams *);
+void RenderFaustParams(FaustParams &);
@@ -8,6 +8,10 @@ const GLenum DataType = GL_UNSIGNED_BYTE;
 
 GLCanvas::~GLCanvas() {
     Destroy();
+    for (uint i = 0; i < 2; i++) {
+        if (PickFences[i]) glDeleteSync(PickFences[i]);
+    }
+    glDeleteBuffers(2, PickPixelBufferIds);
 }
 
 static void CheckFramebufferStatus() {
@@ -69,6 +73,21 @@ void GLCanvas::PrepareRender(uint width, uint height, const glm::vec4 &bg_color)
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ResolveTextureId, 0);
 
         CheckFramebufferStatus();
+
+        glGenFramebuffers(1, &PickFrameBufferId);
+        glBindFramebuffer(GL_FRAMEBUFFER, PickFrameBufferId);
+
+        glGenTextures(1, &PickTextureId);
+        glBindTexture(GL_TEXTURE_2D, PickTextureId);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, Width, Height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, PickTextureId, 0);
+
+        CreateRenderbuffer(PickDepthRenderBufferId, DepthFormat, 1, Width, Height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, PickDepthRenderBufferId);
+
+        CheckFramebufferStatus();
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferId);
@@ -85,10 +104,62 @@ uint GLCanvas::Render() {
     return ResolveTextureId;
 }
 
+void GLCanvas::BeginPick() {
+    glBindFramebuffer(GL_FRAMEBUFFER, PickFrameBufferId);
+    static const GLuint NoId = 0;
+    glClearBufferuiv(GL_COLOR, 0, &NoId);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+}
+
+void GLCanvas::EndPick(int x, int y) {
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    if (x >= 0 && y >= 0 && uint(x) < Width && uint(y) < Height) {
+        const uint i = NextPickRead;
+        if (PickPixelBufferIds[i] == 0) {
+            glGenBuffers(1, &PickPixelBufferIds[i]);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, PickPixelBufferIds[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PickPixelBufferIds[i]);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr); // Returns immediately, since it reads into a buffer.
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (PickFences[i]) glDeleteSync(PickFences[i]);
+        PickFences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        NextPickRead = 1 - i;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferId);
+}
+
+uint GLCanvas::GetPickedId() {
+    // Oldest read first, so a newer completed read takes precedence.
+    for (const uint i : {NextPickRead, 1 - NextPickRead}) {
+        if (!PickFences[i]) continue;
+
+        const GLenum status = glClientWaitSync(PickFences[i], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+
+        glDeleteSync(PickFences[i]);
+        PickFences[i] = nullptr;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PickPixelBufferIds[i]);
+        if (const auto *id = static_cast<const GLuint *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT))) {
+            PickedId = *id;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    return PickedId;
+}
+
 void GLCanvas::Destroy() {
     glDeleteRenderbuffers(1, &DepthRenderBufferId);
     glDeleteTextures(1, &TextureId);
     glDeleteFramebuffers(1, &FrameBufferId);
     glDeleteFramebuffers(1, &ResolveBufferId);
     glDeleteTextures(1, &ResolveTextureId);
+    glDeleteRenderbuffers(1, &PickDepthRenderBufferId);
+    glDeleteTextures(1, &PickTextureId);
+    glDeleteFramebuffers(1, &PickFrameBufferId);
+    // The pick pixel buffers don't depend on the size, so they're only deleted with the canvas.
 }
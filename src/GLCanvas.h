@@ -4,8 +4,14 @@ using uint = unsigned int;
 
 #include <glm/vec4.hpp>
 
+struct __GLsync;
+
 // Render an OpenGL frame buffer to a texture.
 // Uses MSAA if `SubsamplesPerPixel` > 1.
+//
+// Also has a (non-multisampled) ID buffer of the same size, for GPU picking:
+// Draw between `BeginPick` and `EndPick`, writing nonzero `uint` IDs to the fragment output.
+// The ID under a pixel is copied to a pixel buffer and read back once the GPU is done with it, without stalling.
 struct GLCanvas {
     ~GLCanvas();
 
@@ -13,10 +19,19 @@ struct GLCanvas {
     void PrepareRender(uint width, uint height, const glm::vec4 &bg_color);
     uint Render(); // Returns `TextureId` after binding the frame buffer.
 
+    void BeginPick(); // Bind and clear the ID buffer.
+    void EndPick(int x, int y); // Start reading back the ID at pixel (x, y) (from the bottom-left, ignored if outside), and rebind the frame buffer.
+    uint GetPickedId(); // The ID from the most recent completed read (typically the previous frame's), or 0 for none.
+
 private:
     uint Width = 0, Height = 0;
     uint SubsamplesPerPixel = 4;
     uint FrameBufferId, TextureId, DepthRenderBufferId, ResolveBufferId, ResolveTextureId;
+    uint PickFrameBufferId, PickTextureId, PickDepthRenderBufferId;
+    // Reads alternate between two pixel buffers, so a new read can start while the previous one is in flight.
+    uint PickPixelBufferIds[2]{0, 0};
+    __GLsync *PickFences[2]{nullptr, nullptr};
+    uint NextPickRead = 0, PickedId = 0;
 
     void Destroy();
 };
@@ -0,0 +1,119 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+static constexpr uint MaxLeafTriangles = 4;
+
+BVH::BVH(std::span<const glm::vec3> points, std::span<const uint> triangle_indices) {
+    const uint num_triangles = triangle_indices.size() / 3;
+    if (num_triangles == 0) return;
+
+    TriangleBounds.resize(num_triangles);
+    std::vector<glm::vec3> centroids(num_triangles);
+    for (uint i = 0; i < num_triangles; ++i) {
+        const auto &a = points[triangle_indices[i * 3]], &b = points[triangle_indices[i * 3 + 1]], &c = points[triangle_indices[i * 3 + 2]];
+        TriangleBounds[i] = {glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c))};
+        centroids[i] = (a + b + c) / 3.f;
+    }
+    Triangles.resize(num_triangles);
+    std::iota(Triangles.begin(), Triangles.end(), 0);
+    Nodes.reserve(2 * num_triangles / MaxLeafTriangles + 1);
+    Nodes.emplace_back();
+    Build(0, 0, num_triangles, centroids);
+}
+
+void BVH::Build(uint node_index, uint start, uint count, const std::vector<glm::vec3> &centroids) {
+    Box bounds = TriangleBounds[Triangles[start]];
+    Box centroid_bounds{centroids[Triangles[start]], centroids[Triangles[start]]};
+    for (uint i = start + 1; i < start + count; ++i) {
+        const auto &box = TriangleBounds[Triangles[i]];
+        bounds = {glm::min(bounds.Min, box.Min), glm::max(bounds.Max, box.Max)};
+        centroid_bounds = {glm::min(centroid_bounds.Min, centroids[Triangles[i]]), glm::max(centroid_bounds.Max, centroids[Triangles[i]])};
+    }
+    Nodes[node_index].Bounds = bounds;
+    if (count <= MaxLeafTriangles) {
+        Nodes[node_index].Start = start;
+        Nodes[node_index].Count = count;
+        return;
+    }
+
+    const auto extent = centroid_bounds.Max - centroid_bounds.Min;
+    const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+    const uint half = count / 2;
+    auto begin = Triangles.begin() + start;
+    std::nth_element(begin, begin + half, begin + count, [&](uint a, uint b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    // Balanced splits keep the depth at ~log2(n / MaxLeafTriangles), well within the query stack size.
+    const uint left = Nodes.size();
+    Nodes[node_index].Start = left;
+    Nodes[node_index].Count = 0;
+    Nodes.emplace_back();
+    Nodes.emplace_back();
+    Build(left, start, half, centroids);
+    Build(left + 1, start + half, count - half, centroids);
+}
+
+// Ray parameter at which the ray enters `box`, if it hits it before `max_t`. (Slab test.)
+static std::optional<float> RayEntry(const BVH::Box &box, const glm::vec3 &origin, const glm::vec3 &inv_direction, float max_t) {
+    const auto t0 = (box.Min - origin) * inv_direction, t1 = (box.Max - origin) * inv_direction;
+    const auto t_min = glm::min(t0, t1), t_max = glm::max(t0, t1);
+    const float enter = std::max({t_min.x, t_min.y, t_min.z, 0.f}), exit = std::min({t_max.x, t_max.y, t_max.z, max_t});
+    if (enter > exit) return {};
+    return enter;
+}
+
+// Möller-Trumbore ray-triangle intersection. Hits from either side.
+static std::optional<float> RayTriangle(const glm::vec3 &origin, const glm::vec3 &direction, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    const auto ab = b - a, ac = c - a;
+    const auto p = glm::cross(direction, ac);
+    const float det = glm::dot(ab, p);
+    if (std::abs(det) < FLT_EPSILON * glm::dot(ab, ab)) return {}; // Parallel, or degenerate.
+
+    const float inv_det = 1 / det;
+    const auto ao = origin - a;
+    const float u = glm::dot(ao, p) * inv_det;
+    if (u < 0 || u > 1) return {};
+
+    const auto q = glm::cross(ao, ab);
+    const float v = glm::dot(direction, q) * inv_det;
+    if (v < 0 || u + v > 1) return {};
+
+    const float t = glm::dot(ac, q) * inv_det;
+    if (t < 0) return {};
+    return t;
+}
+
+std::optional<BVH::RayHit> BVH::Raycast(const glm::vec3 &origin, const glm::vec3 &direction, std::span<const glm::vec3> points, std::span<const uint> triangle_indices) const {
+    if (Nodes.empty()) return {};
+
+    const auto inv_direction = 1.f / direction; // Infinite for axis-parallel rays, which the slab test handles.
+    std::optional<RayHit> hit;
+    uint stack[64];
+    uint stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const auto &node = Nodes[stack[--stack_size]];
+        if (!RayEntry(node.Bounds, origin, inv_direction, hit ? hit->Distance : FLT_MAX)) continue;
+        if (node.Count > 0) {
+            for (uint i = node.Start; i < node.Start + node.Count; ++i) {
+                const uint triangle = Triangles[i];
+                const uint *ti = &triangle_indices[triangle * 3];
+                const auto t = RayTriangle(origin, direction, points[ti[0]], points[ti[1]], points[ti[2]]);
+                if (t && (!hit || *t < hit->Distance)) hit = RayHit{triangle, *t};
+            }
+        } else {
+            // Visit the nearer child first, so the farther one is more likely to be culled by the closest hit so far.
+            const auto left_t = RayEntry(Nodes[node.Start].Bounds, origin, inv_direction, FLT_MAX);
+            const auto right_t = RayEntry(Nodes[node.Start + 1].Bounds, origin, inv_direction, FLT_MAX);
+            const bool left_first = left_t && (!right_t || *left_t <= *right_t);
+            stack[stack_size++] = left_first ? node.Start + 1 : node.Start;
+            stack[stack_size++] = left_first ? node.Start : node.Start + 1;
+        }
+    }
+    return hit;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+// Bounding volume hierarchy over the triangles of a triangle mesh, with axis-aligned bounding boxes.
+// Built top-down by splitting at the median centroid along the longest axis.
+struct BVH {
+    struct Box {
+        glm::vec3 Min, Max;
+
+        bool Overlaps(const Box &other) const {
+            return Min.x <= other.Max.x && other.Min.x <= Max.x &&
+                Min.y <= other.Max.y && other.Min.y <= Max.y &&
+                Min.z <= other.Max.z && other.Min.z <= Max.z;
+        }
+    };
+
+    struct RayHit {
+        uint Triangle;
+        float Distance; // Ray parameter of the hit, in units of the ray direction's length.
+    };
+
+    BVH(std::span<const glm::vec3> points, std::span<const uint> triangle_indices);
+
+    // Call `f(triangle)` for each triangle whose bounding box overlaps `box`.
+    template<typename F> void ForEachOverlapping(const Box &box, F &&f) const {
+        if (Nodes.empty()) return;
+
+        uint stack[64];
+        uint stack_size = 0;
+        stack[stack_size++] = 0;
+        while (stack_size > 0) {
+            const auto &node = Nodes[stack[--stack_size]];
+            if (!node.Bounds.Overlaps(box)) continue;
+            if (node.Count > 0) {
+                for (uint i = node.Start; i < node.Start + node.Count; ++i) {
+                    if (TriangleBounds[Triangles[i]].Overlaps(box)) f(Triangles[i]);
+                }
+            } else {
+                stack[stack_size++] = node.Start;
+                stack[stack_size++] = node.Start + 1;
+            }
+        }
+    }
+
+    const Box &GetTriangleBounds(uint triangle) const { return TriangleBounds[triangle]; }
+
+    // Nearest intersection of the ray `origin + t * direction` (t >= 0) with a triangle, if any.
+    // `points` and `triangle_indices` must be the ones the BVH was built with.
+    std::optional<RayHit> Raycast(const glm::vec3 &origin, const glm::vec3 &direction, std::span<const glm::vec3> points, std::span<const uint> triangle_indices) const;
+
+private:
+    struct Node {
+        Box Bounds;
+        uint Start; // Leaves: Index of the first triangle in `Triangles`. Interior nodes: Index of the left child (right is next).
+        uint Count; // Number of triangles in a leaf. Zero for interior nodes.
+    };
+
+    void Build(uint node_index, uint start, uint count, const std::vector<glm::vec3> &centroids);
+
+    std::vector<Node> Nodes; // Root first.
+    std::vector<uint> Triangles; // Triangle indices, ordered so each leaf's triangles are contiguous.
+    std::vector<Box> TriangleBounds;
+};
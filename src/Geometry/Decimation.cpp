@@ -0,0 +1,38 @@
+#include "Decimation.h"
+
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+#include <OpenMesh/Tools/Decimater/DecimaterT.hh>
+#include <OpenMesh/Tools/Decimater/ModQuadricT.hh>
+
+using TriMesh = OpenMesh::TriMesh_ArrayKernelT<>;
+
+void Decimation::Decimate(std::vector<glm::vec3> &points, std::vector<uint> &triangle_indices, uint target_faces, float max_error) {
+    const size_t num_triangles = triangle_indices.size() / 3;
+    if (num_triangles <= target_faces) return;
+
+    TriMesh mesh;
+    mesh.reserve(points.size(), num_triangles * 3 / 2, num_triangles);
+    for (const auto &p : points) mesh.add_vertex({p.x, p.y, p.z});
+    for (size_t i = 0; i < triangle_indices.size(); i += 3) {
+        mesh.add_face(mesh.vertex_handle(triangle_indices[i]), mesh.vertex_handle(triangle_indices[i + 1]), mesh.vertex_handle(triangle_indices[i + 2]));
+    }
+
+    OpenMesh::Decimater::DecimaterT<TriMesh> decimater(mesh);
+    OpenMesh::Decimater::ModQuadricT<TriMesh>::Handle quadric;
+    decimater.add(quadric);
+    if (max_error > 0) decimater.module(quadric).set_max_err(max_error); // Binary: Collapses over the bound are disallowed.
+    decimater.initialize();
+    decimater.decimate_to_faces(0, target_faces);
+    mesh.garbage_collection();
+
+    points.resize(mesh.n_vertices());
+    for (const auto &vh : mesh.vertices()) {
+        const auto &p = mesh.point(vh);
+        points[vh.idx()] = {p[0], p[1], p[2]};
+    }
+    triangle_indices.clear();
+    triangle_indices.reserve(mesh.n_faces() * 3);
+    for (const auto &fh : mesh.faces()) {
+        for (const auto &vh : mesh.fv_range(fh)) triangle_indices.push_back(vh.idx());
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+// Quadric error metric simplification (Garland & Heckbert) of triangle meshes, using OpenMesh's Decimater.
+struct Decimation {
+    // Simplify the triangle mesh in place, down to `target_faces` faces.
+    // If `max_error` is nonzero, no edge collapse exceeding that quadric error is performed, even if more faces remain.
+    static void Decimate(std::vector<glm::vec3> &points, std::vector<uint> &triangle_indices, uint target_faces, float max_error = 0);
+};
@@ -1,9 +1,38 @@
 #include "GLGeometry.h"
 
+#include "Scheduler.h"
+
+// Position in attribute 0 and (if given) normal in attribute 1, advancing per vertex or per instance.
+static void EnableElementAttributes(const GLVertexArray &vertex_array, const GLBuffer<glm::vec3, GL_ARRAY_BUFFER> &position_buffer, const GLBuffer<glm::vec3, GL_ARRAY_BUFFER> *normal_buffer, GLuint divisor) {
+    vertex_array.Bind();
+    position_buffer.Bind();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+    glVertexAttribDivisor(0, divisor);
+    if (normal_buffer) {
+        normal_buffer->Bind();
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+        glVertexAttribDivisor(1, divisor);
+    }
+    vertex_array.Unbind();
+}
+
 void GLGeometry::Generate() {
     VertexBuffer.Generate();
     NormalBuffer.Generate();
     IndexBuffer.Generate();
+
+    PointVertexArray.Generate();
+    VertexNormalArray.Generate();
+    FaceNormalArray.Generate();
+    PointBuffer.Generate();
+    VertexNormalBuffer.Generate();
+    FaceCenterBuffer.Generate();
+    FaceNormalBuffer.Generate();
+    EnableElementAttributes(PointVertexArray, PointBuffer, nullptr, 0);
+    EnableElementAttributes(VertexNormalArray, PointBuffer, &VertexNormalBuffer, 1);
+    EnableElementAttributes(FaceNormalArray, FaceCenterBuffer, &FaceNormalBuffer, 1);
 }
 
 void GLGeometry::EnableVertexAttributes() const {
@@ -17,21 +46,60 @@ void GLGeometry::EnableVertexAttributes() const {
     glEnableVertexAttribArray(NormalSlot);
     glVertexAttribPointer(NormalSlot, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
 
-    Dirty = true;
+    MarkBuffersDirty();
 }
 
 void GLGeometry::Delete() const {
     VertexBuffer.Delete();
     NormalBuffer.Delete();
     IndexBuffer.Delete();
+    PointBuffer.Delete();
+    VertexNormalBuffer.Delete();
+    FaceCenterBuffer.Delete();
+    FaceNormalBuffer.Delete();
+    PointVertexArray.Delete();
+    VertexNormalArray.Delete();
+    FaceNormalArray.Delete();
 }
 
 void GLGeometry::BindData(RenderMode render_mode) const {
-    if (Dirty || render_mode != LastBoundRenderMode) {
-        VertexBuffer.SetData(Vertices);
-        if (!Normals.empty()) NormalBuffer.SetData(Normals);
-        IndexBuffer.SetData(Indices);
-    }
+    if (render_mode != LastBoundRenderMode) MarkBuffersDirty();
+    if (!DirtyVertices.Empty()) VertexBuffer.Update(Vertices, DirtyVertices);
+    if (!DirtyNormals.Empty() && !Normals.empty()) NormalBuffer.Update(Normals, DirtyNormals);
+    if (!DirtyIndices.Empty()) IndexBuffer.Update(Indices, DirtyIndices);
     LastBoundRenderMode = render_mode;
-    Dirty = false;
+}
+
+void GLGeometry::UpdatePointBuffer() const {
+    // Mesh points are contiguous, in vertex index order.
+    if (!DirtyPoints.Empty()) PointBuffer.Update({reinterpret_cast<const glm::vec3 *>(GetVertices()), NumVertices()}, DirtyPoints);
+}
+
+void GLGeometry::RenderPoints() const {
+    PointVertexArray.Bind();
+    UpdatePointBuffer();
+    glDrawArrays(GL_POINTS, 0, NumVertices());
+    PointVertexArray.Unbind();
+}
+
+void GLGeometry::RenderVertexNormals() const {
+    VertexNormalArray.Bind();
+    UpdatePointBuffer();
+    if (!DirtyVertexNormals.Empty()) VertexNormalBuffer.Update({reinterpret_cast<const glm::vec3 *>(Mesh.vertex_normals()), NumVertices()}, DirtyVertexNormals);
+    glDrawArraysInstanced(GL_LINES, 0, 2, NumVertices());
+    VertexNormalArray.Unbind();
+}
+
+void GLGeometry::RenderFaceNormals() const {
+    FaceNormalArray.Bind();
+    if (!DirtyFaceCenters.Empty()) {
+        std::vector<glm::vec3> centers(NumFaces());
+        Scheduler::ParallelFor(0, NumFaces(), [&](uint begin, uint end) {
+            for (uint f = begin; f < end; ++f) centers[f] = GetFaceCenter(f);
+        });
+        FaceCenterBuffer.Update(centers, DirtyFaceCenters);
+    }
+    if (!DirtyFaceNormals.Empty()) FaceNormalBuffer.Update({reinterpret_cast<const glm::vec3 *>(Mesh.face_normals()), NumFaces()}, DirtyFaceNormals);
+    glDrawArraysInstanced(GL_LINES, 0, 2, NumFaces());
+    FaceNormalArray.Unbind();
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include <GL/glew.h>
 #include <glm/mat4x4.hpp>
 
@@ -12,11 +14,34 @@ struct GLBuffer {
     void Bind() const { glBindBuffer(Target, Id); }
     void Unbind() const { glBindBuffer(Target, 0); }
 
-    void SetData(const std::vector<DataType> &data, GLenum usage = GL_STATIC_DRAW) const {
+    void SetData(std::span<const DataType> data, GLenum usage = GL_STATIC_DRAW) const {
         Bind();
         glBufferData(Target, data.size() * sizeof(DataType), data.data(), usage);
+        Size = data.size();
+    }
+
+    // Upload only the elements of `data` in `dirty`, and clear it.
+    // If the number of elements changed, the buffer is reallocated and everything is uploaded.
+    void Update(std::span<const DataType> data, DirtyRange &dirty, GLenum usage = GL_STATIC_DRAW) const {
+        if (data.size() != Size) {
+            SetData(data, usage);
+        } else if (const size_t begin = dirty.Begin, end = std::min(size_t(dirty.End), data.size()); begin < end) {
+            Bind();
+            glBufferSubData(Target, begin * sizeof(DataType), (end - begin) * sizeof(DataType), data.data() + begin);
+        }
+        dirty.Clear();
     }
 
+    uint Id = 0;
+    mutable size_t Size = 0; // Number of elements allocated.
+};
+
+struct GLVertexArray {
+    void Generate() { glGenVertexArrays(1, &Id); }
+    void Delete() const { glDeleteVertexArrays(1, &Id); }
+    void Bind() const { glBindVertexArray(Id); }
+    void Unbind() const { glBindVertexArray(0); }
+
     uint Id = 0;
 };
 
@@ -39,10 +64,24 @@ struct GLGeometry : Geometry {
 
     void BindData(RenderMode) const; // Only rebinds the data if it has changed.
 
+    // Draw each mesh vertex as a point, with `gl_VertexID` equal to the vertex index (regardless of render mode).
+    // Used for GPU picking. Positions are in attribute 0.
+    void RenderPoints() const;
+
+    // Draw one instance of a two-vertex line (`gl_VertexID` 0 and 1) per vertex or face, for normal indicators.
+    // The vertex position or face center is in per-instance attribute 0, and its normal in per-instance attribute 1.
+    // Buffers are only filled when first drawn, and after the mesh changes.
+    void RenderVertexNormals() const;
+    void RenderFaceNormals() const;
+
 private:
     GLBuffer<glm::vec3, GL_ARRAY_BUFFER> VertexBuffer;
     GLBuffer<glm::vec3, GL_ARRAY_BUFFER> NormalBuffer;
     GLBuffer<uint, GL_ELEMENT_ARRAY_BUFFER> IndexBuffer;
+    GLVertexArray PointVertexArray, VertexNormalArray, FaceNormalArray;
+    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> PointBuffer, VertexNormalBuffer, FaceCenterBuffer, FaceNormalBuffer;
+
+    void UpdatePointBuffer() const;
 
     mutable RenderMode LastBoundRenderMode = RenderMode::Smooth;
 };
@@ -1,44 +1,269 @@
 #include "Geometry.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
 #include <glm/geometric.hpp>
 
-uint Geometry::FindVertextNearestTo(const glm::vec3 point) const {
-    uint nearest_index = 0;
-    float nearest_distance = std::numeric_limits<float>::max();
-    for (uint i = 0; i < NumVertices(); i++) {
-        const float distance = glm::distance(point, GetVertex(i));
-        if (distance < nearest_distance) {
-            nearest_distance = distance;
-            nearest_index = i;
+#include "ObjReader.h"
+#include "Scheduler.h"
+
+bool Geometry::Load(const fs::path &file_path) {
+    if (file_path.extension() != ".obj") {
+        OpenMesh::IO::Options read_options; // No options used yet, but keeping this here for future use.
+        if (!OpenMesh::IO::read_mesh(Mesh, file_path.string(), read_options)) {
+            std::cerr << "Error loading mesh: " << file_path << std::endl;
+            return false;
         }
+        UpdateBuffersFromMesh();
+        return true;
+    }
+
+    ObjReader::Polygons polygons;
+    try {
+        polygons = ObjReader::Read(file_path);
+    } catch (const std::exception &e) {
+        std::cerr << "Error loading mesh: " << e.what() << std::endl;
+        return false;
+    }
+
+    // Building the halfedge structure is inherently sequential, but it's done straight from the parsed arrays.
+    if (const uint skipped_faces = SetPolygons(polygons.Points, polygons.FaceSizes, polygons.Indices); skipped_faces > 0) {
+        std::cerr << "Skipped " << skipped_faces << " non-manifold faces loading " << file_path << std::endl;
     }
-    return nearest_index;
+    return true;
 }
 
-std::vector<uint> Geometry::GenerateTriangleIndices() const {
-    auto triangulated_mesh = Mesh; // `triangulate` is in-place, so we need to make a copy.
-    triangulated_mesh.triangulate();
-    std::vector<uint> indices;
-    for (const auto &fh : triangulated_mesh.faces()) {
-        auto v_it = triangulated_mesh.cfv_iter(fh);
-        indices.insert(indices.end(), {uint(v_it->idx()), uint((++v_it)->idx()), uint((++v_it)->idx())});
+uint Geometry::SetPolygons(
+    std::span<const glm::vec3> points, std::span<const uint> face_sizes, std::span<const uint> indices,
+    std::span<const glm::vec3> vertex_normals, std::span<const glm::vec3> face_normals
+) {
+    Clear();
+    const bool has_normals = vertex_normals.size() == points.size() && face_normals.size() == face_sizes.size();
+    Mesh.reserve(points.size(), indices.size() / 2, face_sizes.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        const auto &p = points[i];
+        const auto vh = Mesh.add_vertex({p.x, p.y, p.z});
+        if (has_normals) Mesh.set_normal(vh, {vertex_normals[i].x, vertex_normals[i].y, vertex_normals[i].z});
     }
-    return indices;
+    std::vector<VH> face;
+    uint skipped_faces = 0;
+    for (size_t face_i = 0, index_i = 0; face_i < face_sizes.size(); index_i += face_sizes[face_i++]) {
+        face.clear();
+        for (uint i = 0; i < face_sizes[face_i]; ++i) face.emplace_back(indices[index_i + i]);
+        const auto fh = Mesh.add_face(face);
+        if (!fh.is_valid()) ++skipped_faces;
+        else if (has_normals) Mesh.set_normal(fh, {face_normals[face_i].x, face_normals[face_i].y, face_normals[face_i].z});
+    }
+
+    UpdateVertices();
+    if (has_normals) UpdateNormalBuffer();
+    else UpdateNormals();
+    UpdateIndices();
+    return skipped_faces;
 }
 
-std::vector<uint> Geometry::GenerateTriangulatedFaceIndices() const {
+const KdTree &Geometry::GetVertexTree() const {
+    if (!VertexTree) VertexTree.emplace(GetPoints());
+    return *VertexTree;
+}
+
+uint Geometry::FindVertextNearestTo(const glm::vec3 point) const {
+    const auto &tree = GetVertexTree();
+    return tree.Empty() ? 0 : tree.FindNearest(point);
+}
+
+std::vector<uint> Geometry::FindVerticesNearestTo(const glm::vec3 &point, uint k) const {
+    return GetVertexTree().FindNearest(point, k);
+}
+
+const ScreenProjection::Points &Geometry::GetProjectionPoints() const {
+    if (!ProjectionPoints) ProjectionPoints.emplace(GetPoints());
+    return *ProjectionPoints;
+}
+
+std::optional<BVH::RayHit> Geometry::Raycast(const glm::vec3 &origin, const glm::vec3 &direction) const {
+    const auto &triangle_indices = GetTriangleIndices();
+    if (!TriangleTree) TriangleTree.emplace(GetPoints(), triangle_indices);
+    return TriangleTree->Raycast(origin, direction, GetPoints(), triangle_indices);
+}
+
+// Fan-triangulates each face in place of `MeshType::triangulate`, which only works in-place and would require copying the mesh.
+// Produces the same triangles as `triangulate` for convex faces.
+const std::vector<uint> &Geometry::GetTriangleIndices() const {
+    if (TriangleIndices) return *TriangleIndices;
+
+    size_t num_triangles = 0;
+    for (const auto &fh : Mesh.faces()) num_triangles += Mesh.valence(fh) - 2;
+
     std::vector<uint> indices;
-    uint index = 0;
+    indices.reserve(num_triangles * 3);
     for (const auto &fh : Mesh.faces()) {
-        auto valence = Mesh.valence(fh);
-        for (uint i = 0; i < valence - 2; ++i) {
-            indices.insert(indices.end(), {index, index + i + 1, index + i + 2});
+        auto fv_it = Mesh.cfv_iter(fh);
+        const uint first = fv_it->idx();
+        uint prev = (++fv_it)->idx();
+        for (++fv_it; fv_it.is_valid(); ++fv_it) {
+            const uint curr = fv_it->idx();
+            indices.insert(indices.end(), {first, prev, curr});
+            prev = curr;
         }
-        index += valence;
     }
+    return TriangleIndices.emplace(std::move(indices));
+}
+
+const std::vector<uint> &Geometry::GetFaceCornerOffsets() const {
+    if (FaceCornerOffsets) return *FaceCornerOffsets;
+
+    std::vector<uint> offsets(Mesh.n_faces() + 1);
+    offsets[0] = 0;
+    for (const auto &fh : Mesh.faces()) offsets[fh.idx() + 1] = offsets[fh.idx()] + Mesh.valence(fh);
+    return FaceCornerOffsets.emplace(std::move(offsets));
+}
+
+std::vector<uint> Geometry::GenerateTriangulatedFaceIndices() const {
+    const auto &offsets = GetFaceCornerOffsets();
+    const uint num_faces = Mesh.n_faces();
+    // A face with `n` corners has `n - 2` triangles, so `offsets[f] - 2f` triangles come before face `f`.
+    std::vector<uint> indices((offsets[num_faces] - 2 * num_faces) * 3);
+    Scheduler::ParallelFor(0, num_faces, [&](uint face_begin, uint face_end) {
+        for (uint f = face_begin; f < face_end; ++f) {
+            const uint first = offsets[f];
+            uint *out = indices.data() + (first - 2 * f) * 3;
+            for (uint corner = first + 1; corner + 1 < offsets[f + 1]; ++corner, out += 3) {
+                out[0] = first, out[1] = corner, out[2] = corner + 1;
+            }
+        }
+    });
     return indices;
 }
 
+void Geometry::UpdateVertices() {
+    if (ActiveRenderMode == RenderMode::Flat) {
+        const auto &offsets = GetFaceCornerOffsets();
+        Vertices.resize(offsets.back());
+        Scheduler::ParallelFor(0, Mesh.n_faces(), [&](uint face_begin, uint face_end) {
+            for (uint f = face_begin; f < face_end; ++f) {
+                glm::vec3 *out = Vertices.data() + offsets[f];
+                for (const auto &vh : Mesh.fv_range(FH(f))) *out++ = ToGlm(Mesh.point(vh));
+            }
+        });
+    } else {
+        const auto *points = reinterpret_cast<const glm::vec3 *>(Mesh.points());
+        Vertices.assign(points, points + Mesh.n_vertices());
+    }
+    DirtyVertices.AddAll();
+    DirtyPoints.AddAll();
+    DirtyFaceCenters.AddAll();
+}
+
+void Geometry::UpdateNormalBuffer() {
+    if (ActiveRenderMode == RenderMode::Flat) {
+        const auto &offsets = GetFaceCornerOffsets();
+        Normals.resize(offsets.back());
+        // Duplicate the face normal for each corner.
+        Scheduler::ParallelFor(0, Mesh.n_faces(), [&](uint face_begin, uint face_end) {
+            for (uint f = face_begin; f < face_end; ++f) std::fill(Normals.begin() + offsets[f], Normals.begin() + offsets[f + 1], ToGlm(Mesh.normal(FH(f))));
+        });
+    } else {
+        const auto *normals = reinterpret_cast<const glm::vec3 *>(Mesh.vertex_normals());
+        Normals.assign(normals, normals + Mesh.n_vertices());
+    }
+    DirtyNormals.AddAll();
+    DirtyVertexNormals.AddAll();
+    DirtyFaceNormals.AddAll();
+}
+
+// Unit face normals, and vertex normals as the normalized sum of adjacent face normals (same as `MeshType::update_normals`).
+// The arithmetic runs over structure-of-arrays buffers in branch-free loops,
+// which the compiler vectorizes for whichever SIMD instruction set it targets (SSE/AVX/NEON).
+static void ComputeTriangleNormals(
+    const std::vector<glm::vec3> &points, const std::vector<uint> &indices,
+    std::vector<glm::vec3> &face_normals, std::vector<glm::vec3> &vertex_normals
+) {
+    const size_t num_triangles = indices.size() / 3, num_points = points.size();
+    std::vector<float> e1x(num_triangles), e1y(num_triangles), e1z(num_triangles);
+    std::vector<float> e2x(num_triangles), e2y(num_triangles), e2z(num_triangles);
+    for (size_t t = 0; t < num_triangles; t++) {
+        const auto &a = points[indices[t * 3]], &b = points[indices[t * 3 + 1]], &c = points[indices[t * 3 + 2]];
+        e1x[t] = b.x - a.x, e1y[t] = b.y - a.y, e1z[t] = b.z - a.z;
+        e2x[t] = c.x - a.x, e2y[t] = c.y - a.y, e2z[t] = c.z - a.z;
+    }
+    // Face normals overwrite the first edge.
+    for (size_t t = 0; t < num_triangles; t++) {
+        const float nx = e1y[t] * e2z[t] - e1z[t] * e2y[t];
+        const float ny = e1z[t] * e2x[t] - e1x[t] * e2z[t];
+        const float nz = e1x[t] * e2y[t] - e1y[t] * e2x[t];
+        const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        const float inv_length = length > 0 ? 1 / length : 0;
+        e1x[t] = nx * inv_length, e1y[t] = ny * inv_length, e1z[t] = nz * inv_length;
+    }
+
+    std::vector<float> vx(num_points, 0), vy(num_points, 0), vz(num_points, 0);
+    face_normals.resize(num_triangles);
+    for (size_t t = 0; t < num_triangles; t++) {
+        face_normals[t] = {e1x[t], e1y[t], e1z[t]};
+        for (uint corner = 0; corner < 3; corner++) {
+            const uint v = indices[t * 3 + corner];
+            vx[v] += e1x[t], vy[v] += e1y[t], vz[v] += e1z[t];
+        }
+    }
+    for (size_t v = 0; v < num_points; v++) {
+        const float length = std::sqrt(vx[v] * vx[v] + vy[v] * vy[v] + vz[v] * vz[v]);
+        const float inv_length = length > 0 ? 1 / length : 0;
+        vx[v] *= inv_length, vy[v] *= inv_length, vz[v] *= inv_length;
+    }
+    vertex_normals.resize(num_points);
+    for (size_t v = 0; v < num_points; v++) vertex_normals[v] = {vx[v], vy[v], vz[v]};
+}
+
+void Geometry::SetTriangles(const std::vector<glm::vec3> &points, const std::vector<uint> &triangle_indices) {
+    Clear();
+    const size_t num_triangles = triangle_indices.size() / 3;
+    std::vector<glm::vec3> face_normals, vertex_normals;
+    ComputeTriangleNormals(points, triangle_indices, face_normals, vertex_normals);
+
+    Mesh.reserve(points.size(), num_triangles * 3 / 2, num_triangles);
+    for (size_t i = 0; i < points.size(); i++) {
+        const auto &p = points[i];
+        const auto &n = vertex_normals[i];
+        const auto vh = Mesh.add_vertex({p.x, p.y, p.z});
+        Mesh.set_normal(vh, {n.x, n.y, n.z});
+    }
+    for (size_t t = 0; t < num_triangles; t++) {
+        const uint *tri = &triangle_indices[t * 3];
+        const auto fh = Mesh.add_face(VH(tri[0]), VH(tri[1]), VH(tri[2]));
+        if (fh.is_valid()) Mesh.set_normal(fh, {face_normals[t].x, face_normals[t].y, face_normals[t].z});
+    }
+    if (Mesh.n_faces() != num_triangles) {
+        // Some faces were rejected (e.g. non-manifold), so the input no longer matches the mesh.
+        // Rebuild everything, including normals, from the faces that were accepted.
+        UpdateBuffersFromMesh();
+        return;
+    }
+    TriangleIndices = triangle_indices;
+
+    if (ActiveRenderMode == RenderMode::Flat) {
+        // Duplicate vertices for each triangle, with the face normal.
+        Vertices.reserve(num_triangles * 3);
+        Normals.reserve(num_triangles * 3);
+        for (size_t t = 0; t < num_triangles; t++) {
+            for (uint corner = 0; corner < 3; corner++) {
+                Vertices.push_back(points[triangle_indices[t * 3 + corner]]);
+                Normals.push_back(face_normals[t]);
+            }
+        }
+        Indices.resize(num_triangles * 3);
+        std::iota(Indices.begin(), Indices.end(), 0);
+    } else {
+        Vertices = points;
+        Normals = std::move(vertex_normals);
+        Indices = ActiveRenderMode == RenderMode::Lines ? GenerateLineIndices() : triangle_indices;
+    }
+    MarkBuffersDirty();
+}
+
 std::vector<uint> Geometry::GenerateLineIndices() const {
     std::vector<uint> indices;
     indices.reserve(Mesh.n_edges() * 2);
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <span>
 
 #include <OpenMesh/Core/IO/MeshIO.hh>
 #include <OpenMesh/Core/Mesh/PolyMesh_ArrayKernelT.hh>
@@ -8,6 +12,10 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
+#include "BVH.h"
+#include "KdTree.h"
+#include "ScreenProjection.h"
+
 using uint = unsigned int;
 
 namespace fs = std::filesystem;
@@ -19,6 +27,25 @@ enum class RenderMode {
     Points,
 };
 
+// Range of buffer elements changed since the buffer was last uploaded, so only that range needs to be transferred.
+struct DirtyRange {
+    uint Begin = 0, End = UINT32_MAX; // Everything is dirty until the first upload.
+
+    bool Empty() const { return Begin >= End; }
+    void Add(uint begin, uint end) {
+        if (Empty()) {
+            Begin = begin;
+            End = end;
+        } else {
+            Begin = std::min(Begin, begin);
+            End = std::max(End, end);
+        }
+    }
+    void Add(uint index) { Add(index, index + 1); }
+    void AddAll() { Add(0, UINT32_MAX); }
+    void Clear() { Begin = End = 0; }
+};
+
 inline static glm::vec3 ToGlm(const OpenMesh::Vec3f &v) { return {v[0], v[1], v[2]}; }
 
 struct Geometry {
@@ -49,7 +76,10 @@ struct Geometry {
     virtual void PrepareRender(RenderMode mode) {
         if (ActiveRenderMode == mode) return;
         ActiveRenderMode = mode;
-        UpdateBuffersFromMesh();
+        // Neither the topology nor the normals change with the render mode, so only the buffer layout is updated.
+        UpdateVertices();
+        UpdateNormalBuffer();
+        UpdateIndices();
     }
 
     inline const MeshType &GetMesh() const { return Mesh; }
@@ -57,6 +87,10 @@ struct Geometry {
     inline uint NumVertices() const { return Mesh.n_vertices(); }
     inline uint NumFaces() const { return Mesh.n_faces(); }
     inline uint NumIndices() const { return Indices.size(); }
+    // Render buffers, laid out for the active render mode.
+    inline std::span<const glm::vec3> GetRenderVertices() const { return Vertices; }
+    inline std::span<const glm::vec3> GetRenderNormals() const { return Normals; }
+    inline std::span<const uint> GetRenderIndices() const { return Indices; }
 
     inline const float *GetVertices() const { return (const float *)Mesh.points(); }
     inline glm::vec3 GetVertex(uint index) const { return ToGlm(Mesh.point(VH(index))); }
@@ -64,22 +98,23 @@ struct Geometry {
     inline glm::vec3 GetFaceNormal(uint index) const { return ToGlm(Mesh.normal(FH(index))); }
     inline glm::vec3 GetFaceCenter(uint index) const { return ToGlm(Mesh.calc_face_centroid(FH(index))); }
 
-    uint FindVertextNearestTo(const glm::vec3 point) const;
+    // Spatial queries, using indices built on first use and kept until the points or topology change.
+    uint FindVertextNearestTo(const glm::vec3 point) const; // Returns 0 if there are no vertices.
+    std::vector<uint> FindVerticesNearestTo(const glm::vec3 &point, uint k) const; // Up to `k` vertices, nearest first.
+    // Nearest hit of the ray `origin + t * direction` (t >= 0) with a face.
+    // `Triangle` indexes the triangles of `GetTriangleIndices`.
+    std::optional<BVH::RayHit> Raycast(const glm::vec3 &origin, const glm::vec3 &direction) const;
+    // Vertex positions laid out for batched screen-space queries. Cached like the spatial indices.
+    const ScreenProjection::Points &GetProjectionPoints() const;
     inline bool Empty() const { return Vertices.empty(); }
 
-    std::vector<uint> GenerateTriangleIndices() const;
+    // Fan-triangulated vertex indices of all faces. Cached until the topology changes.
+    const std::vector<uint> &GetTriangleIndices() const;
     std::vector<uint> GenerateTriangulatedFaceIndices() const;
     std::vector<uint> GenerateLineIndices() const;
 
-    bool Load(const fs::path &file_path) {
-        OpenMesh::IO::Options read_options; // No options used yet, but keeping this here for future use.
-        if (!OpenMesh::IO::read_mesh(Mesh, file_path.string(), read_options)) {
-            std::cerr << "Error loading mesh: " << file_path << std::endl;
-            return false;
-        }
-        UpdateBuffersFromMesh();
-        return true;
-    }
+    // OBJ files are read with the parallel `ObjReader`. Other formats go through OpenMesh.
+    bool Load(const fs::path &file_path);
 
     void Save(const fs::path &file_path) const {
         if (file_path.extension() != ".obj") throw std::runtime_error("Unsupported file type: " + file_path.string());
@@ -90,7 +125,10 @@ struct Geometry {
     }
 
     // [{min_x, min_y, min_z}, {max_x, max_y, max_z}]
+    // Cached like the spatial indices, since it's used every frame (e.g. to scale normal indicators).
     std::pair<glm::vec3, glm::vec3> ComputeBounds() const {
+        if (Bounds) return *Bounds;
+
         static const float min_float = std::numeric_limits<float>::lowest();
         static const float max_float = std::numeric_limits<float>::max();
 
@@ -105,7 +143,8 @@ struct Geometry {
             max.z = std::max(max.z, p[2]);
         }
 
-        return {min, max};
+        Bounds.emplace(min, max);
+        return *Bounds;
     }
 
     // Centers the actual points to the center of gravity, not just a transform.
@@ -116,6 +155,7 @@ struct Geometry {
             const auto &point = Mesh.point(vh);
             Mesh.set_point(vh, point - cog);
         }
+        ResetSpatialIndices();
         UpdateVertices(); // Normals/indices are not affected.
     }
 
@@ -127,6 +167,19 @@ struct Geometry {
         UpdateBuffersFromMesh();
     }
 
+    // Fast path for triangle meshes given as flat arrays (e.g. TetGen output), instead of building a mesh for `SetOpenMesh`.
+    // Render buffers are filled directly from the arrays, and the OpenMesh representation (still needed for vertex queries
+    // and render mode changes) is built into preallocated storage, with normals copied rather than recomputed.
+    void SetTriangles(const std::vector<glm::vec3> &points, const std::vector<uint> &triangle_indices);
+
+    // Build from polygons given as flat arrays: `face_sizes[i]` vertex indices per face, concatenated in `indices`.
+    // If vertex and face normals are given (e.g. from a cache), they're used instead of being recomputed.
+    // Returns the number of faces skipped because OpenMesh rejected them (non-manifold).
+    uint SetPolygons(
+        std::span<const glm::vec3> points, std::span<const uint> face_sizes, std::span<const uint> indices,
+        std::span<const glm::vec3> vertex_normals = {}, std::span<const glm::vec3> face_normals = {}
+    );
+
     void ExtrudeProfile(const std::vector<glm::vec2> &profile_vertices, uint slices, bool closed = false);
 
     void Clear() {
@@ -134,70 +187,81 @@ struct Geometry {
         Vertices.clear();
         Normals.clear();
         Indices.clear();
-        Dirty = true;
+        TriangleIndices.reset();
+        FaceCornerOffsets.reset();
+        ResetSpatialIndices();
+        MarkBuffersDirty();
     }
 
 protected:
     MeshType Mesh;
     RenderMode ActiveRenderMode{RenderMode::Flat};
-    mutable bool Dirty{true};
+    mutable DirtyRange DirtyVertices, DirtyNormals, DirtyIndices; // Ranges of the render buffers not yet uploaded.
+    // Ranges of the mesh element buffers (one element per vertex or face, independent of the render mode) not yet uploaded.
+    mutable DirtyRange DirtyPoints, DirtyVertexNormals, DirtyFaceCenters, DirtyFaceNormals;
+
+    void MarkBuffersDirty() const {
+        DirtyPoints.AddAll();
+        DirtyVertexNormals.AddAll();
+        DirtyFaceCenters.AddAll();
+        DirtyFaceNormals.AddAll();
+        DirtyVertices.AddAll();
+        DirtyNormals.AddAll();
+        DirtyIndices.AddAll();
+    }
 
+    // Call after any change to the mesh topology.
     void UpdateBuffersFromMesh() {
+        TriangleIndices.reset();
+        FaceCornerOffsets.reset();
+        ResetSpatialIndices();
         UpdateVertices();
         UpdateNormals();
         UpdateIndices();
     }
 
-    void UpdateVertices() {
-        Vertices.clear();
-        if (ActiveRenderMode == RenderMode::Flat) {
-            for (const auto &fh : Mesh.faces()) {
-                for (const auto &vh : Mesh.fv_range(fh)) {
-                    const auto &p = Mesh.point(vh);
-                    Vertices.emplace_back(p[0], p[1], p[2]);
-                }
-            }
-        } else {
-            for (const auto &vh : Mesh.vertices()) {
-                const auto &p = Mesh.point(vh);
-                Vertices.emplace_back(p[0], p[1], p[2]);
-            }
-        }
-        Dirty = true;
-    }
-
+    // In Flat mode, each face's corners get their own vertex with the face normal.
+    // The corners of each face are written in parallel, at offsets from `GetFaceCornerOffsets`.
+    void UpdateVertices();
     void UpdateIndices() {
         Indices =
             ActiveRenderMode == RenderMode::Lines ? GenerateLineIndices() :
             ActiveRenderMode == RenderMode::Flat  ? GenerateTriangulatedFaceIndices() :
-                                                    GenerateTriangleIndices();
-        Dirty = true;
+                                                    GetTriangleIndices();
+        DirtyIndices.AddAll();
     }
 
     void UpdateNormals() {
-        Normals.clear();
-
         Mesh.update_normals();
-        if (ActiveRenderMode == RenderMode::Flat) {
-            for (const auto &fh : Mesh.faces()) {
-                const auto &n = Mesh.normal(fh);
-                // Duplicate the normal for each vertex.
-                for (size_t i = 0; i < Mesh.valence(fh); ++i) {
-                    Normals.emplace_back(n[0], n[1], n[2]);
-                }
-            }
-        } else {
-            for (const auto &vh : Mesh.vertices()) {
-                const auto &n = Mesh.normal(vh);
-                Normals.emplace_back(n[0], n[1], n[2]);
-            }
-        }
-
-        Dirty = true;
+        UpdateNormalBuffer();
     }
 
+    void UpdateNormalBuffer(); // Fill `Normals` from the mesh normals, without recomputing them.
+
     // Used for rendering. Note that `Vertices` and `Normals` depend on the active render mode, and may contain duplicates.
     std::vector<glm::vec3> Vertices;
     std::vector<glm::vec3> Normals;
     std::vector<uint> Indices;
+
+private:
+    // Topology caches, reset by `Clear` and `UpdateBuffersFromMesh`.
+    mutable std::optional<std::vector<uint>> TriangleIndices; // Cache for `GetTriangleIndices`.
+    mutable std::optional<std::vector<uint>> FaceCornerOffsets; // Cache for `GetFaceCornerOffsets`.
+    // Spatial indices, reset by `Clear`, `UpdateBuffersFromMesh` and `Center` (anything that moves points).
+    mutable std::optional<KdTree> VertexTree;
+    mutable std::optional<BVH> TriangleTree;
+    mutable std::optional<ScreenProjection::Points> ProjectionPoints;
+    mutable std::optional<std::pair<glm::vec3, glm::vec3>> Bounds;
+
+    void ResetSpatialIndices() const {
+        VertexTree.reset();
+        TriangleTree.reset();
+        ProjectionPoints.reset();
+        Bounds.reset();
+    }
+    std::span<const glm::vec3> GetPoints() const { return {reinterpret_cast<const glm::vec3 *>(Mesh.points()), Mesh.n_vertices()}; }
+    const KdTree &GetVertexTree() const;
+
+    // Index of each face's first corner in the Flat mode buffers (the prefix sum of face valences), with the total at the end.
+    const std::vector<uint> &GetFaceCornerOffsets() const;
 };
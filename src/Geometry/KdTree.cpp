@@ -0,0 +1,101 @@
+#include "KdTree.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+KdTree::KdTree(std::span<const glm::vec3> points) {
+    Nodes.resize(points.size());
+    for (uint i = 0; i < points.size(); ++i) Nodes[i] = {points[i], i, 0};
+    Build(0, Nodes.size());
+}
+
+void KdTree::Build(uint begin, uint end) {
+    if (end - begin <= 1) return;
+
+    glm::vec3 min = Nodes[begin].Point, max = min;
+    for (uint i = begin + 1; i < end; ++i) {
+        min = glm::min(min, Nodes[i].Point);
+        max = glm::max(max, Nodes[i].Point);
+    }
+    const auto extent = max - min;
+    const uint axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+    const uint mid = (begin + end) / 2;
+    std::nth_element(Nodes.begin() + begin, Nodes.begin() + mid, Nodes.begin() + end, [axis](const auto &a, const auto &b) { return a.Point[axis] < b.Point[axis]; });
+    Nodes[mid].Axis = axis;
+    Build(begin, mid);
+    Build(mid + 1, end);
+}
+
+namespace {
+struct NearestResult {
+    float DistanceSquared = FLT_MAX;
+    uint Index = 0;
+
+    float Bound() const { return DistanceSquared; }
+    void Add(float distance_squared, uint index) {
+        if (distance_squared < DistanceSquared) {
+            DistanceSquared = distance_squared;
+            Index = index;
+        }
+    }
+};
+
+// Max-heap of the `K` nearest so far, by squared distance.
+struct KNearestResults {
+    uint K;
+    std::vector<std::pair<float, uint>> Heap;
+
+    float Bound() const { return Heap.size() < K ? FLT_MAX : Heap.front().first; }
+    void Add(float distance_squared, uint index) {
+        if (Heap.size() < K) {
+            Heap.emplace_back(distance_squared, index);
+            std::push_heap(Heap.begin(), Heap.end());
+        } else if (distance_squared < Heap.front().first) {
+            std::pop_heap(Heap.begin(), Heap.end());
+            Heap.back() = {distance_squared, index};
+            std::push_heap(Heap.begin(), Heap.end());
+        }
+    }
+};
+} // namespace
+
+// Visit the nodes in [begin, end) that could be closer to `point` than `results.Bound()`, nearer side of each split first.
+template<typename Results> void KdTree::Search(uint begin, uint end, const glm::vec3 &point, Results &results) const {
+    while (begin < end) {
+        const uint mid = (begin + end) / 2;
+        const auto &node = Nodes[mid];
+        const auto delta = point - node.Point;
+        results.Add(glm::dot(delta, delta), node.Index);
+
+        const float split_delta = delta[node.Axis];
+        const bool left_first = split_delta < 0;
+        if (left_first) Search(begin, mid, point, results);
+        else Search(mid + 1, end, point, results);
+        if (split_delta * split_delta >= results.Bound()) return;
+
+        // Continue with the far side.
+        if (left_first) begin = mid + 1;
+        else end = mid;
+    }
+}
+
+uint KdTree::FindNearest(const glm::vec3 &point) const {
+    NearestResult result;
+    Search(0, Nodes.size(), point, result);
+    return result.Index;
+}
+
+std::vector<uint> KdTree::FindNearest(const glm::vec3 &point, uint k) const {
+    KNearestResults results{std::min(k, uint(Nodes.size())), {}};
+    if (results.K == 0) return {};
+
+    results.Heap.reserve(results.K);
+    Search(0, Nodes.size(), point, results);
+    std::sort_heap(results.Heap.begin(), results.Heap.end());
+    std::vector<uint> indices(results.Heap.size());
+    std::transform(results.Heap.begin(), results.Heap.end(), indices.begin(), [](const auto &entry) { return entry.second; });
+    return indices;
+}
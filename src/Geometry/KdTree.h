@@ -0,0 +1,34 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+// Static k-d tree over a set of points, for nearest-neighbor queries.
+// Built top-down by splitting at the median along the axis of greatest extent.
+// The tree is implicit: the node for the range [begin, end) of `Nodes` is its median element, at (begin + end) / 2.
+struct KdTree {
+    KdTree(std::span<const glm::vec3> points);
+
+    bool Empty() const { return Nodes.empty(); }
+
+    // Index (into the points the tree was built with) of the point nearest to `point`. The tree must not be empty.
+    uint FindNearest(const glm::vec3 &point) const;
+    // Indices of the (up to) `k` points nearest to `point`, nearest first.
+    std::vector<uint> FindNearest(const glm::vec3 &point, uint k) const;
+
+private:
+    struct Node {
+        glm::vec3 Point;
+        uint Index; // Index of the point in the input.
+        uint Axis; // Split axis of the node's range.
+    };
+
+    void Build(uint begin, uint end);
+    template<typename Results> void Search(uint begin, uint end, const glm::vec3 &, Results &) const;
+
+    std::vector<Node> Nodes;
+};
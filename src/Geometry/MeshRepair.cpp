@@ -0,0 +1,253 @@
+#include "MeshRepair.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <format>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "BVH.h"
+#include "Scheduler.h"
+
+using glm::vec3;
+
+std::string MeshRepair::Report::Describe() const {
+    std::string description = std::format(
+        "{} vertices: {}\nDegenerate faces{}: {}\nDuplicate faces{}: {}\n"
+        "Boundary edges: {}\nNon-manifold edges: {}\nSelf-intersections: {}",
+        Repaired ? "Welded" : "Coincident", WeldedVertices, Repaired ? " removed" : "", DegenerateFaces, Repaired ? " removed" : "", DuplicateFaces,
+        BoundaryEdges, NonManifoldEdges, SelfIntersections
+    );
+    if (!IsWatertight()) description += "\nThe surface is not closed and manifold.";
+    if (SelfIntersections > 0) description += "\nThe surface intersects itself.";
+    return description;
+}
+
+struct FaceHash {
+    size_t operator()(const std::array<uint, 3> &f) const { return std::hash<uint64_t>{}((uint64_t(f[0]) << 32 | f[1]) ^ (uint64_t(f[2]) * 0x9e3779b97f4a7c15ull)); }
+};
+
+static uint64_t CellKey(int x, int y, int z) {
+    // 21 bits per axis. Collisions only cost extra distance checks.
+    return (uint64_t(x) & 0x1fffff) | ((uint64_t(y) & 0x1fffff) << 21) | ((uint64_t(z) & 0x1fffff) << 42);
+}
+
+// Merge each vertex into the first earlier vertex within `tolerance`, using a uniform grid with cells of that size,
+// so only the neighboring 27 cells need to be checked. Returns the new index of each vertex, and compacts `points`.
+static std::vector<uint> Weld(std::vector<vec3> &points, float tolerance) {
+    std::vector<uint> remap(points.size());
+    if (tolerance <= 0) {
+        for (uint i = 0; i < points.size(); ++i) remap[i] = i;
+        return remap;
+    }
+
+    const float inv_cell_size = 1 / tolerance, tolerance_squared = tolerance * tolerance;
+    std::unordered_map<uint64_t, std::vector<uint>> cells; // Indices into `welded`.
+    cells.reserve(points.size());
+    std::vector<vec3> welded;
+    welded.reserve(points.size());
+    for (uint i = 0; i < points.size(); ++i) {
+        const auto &p = points[i];
+        const int cx = std::floor(p.x * inv_cell_size), cy = std::floor(p.y * inv_cell_size), cz = std::floor(p.z * inv_cell_size);
+        int match = -1;
+        for (int dx = -1; dx <= 1 && match < 0; ++dx) {
+            for (int dy = -1; dy <= 1 && match < 0; ++dy) {
+                for (int dz = -1; dz <= 1 && match < 0; ++dz) {
+                    const auto it = cells.find(CellKey(cx + dx, cy + dy, cz + dz));
+                    if (it == cells.end()) continue;
+                    for (const uint j : it->second) {
+                        const auto d = welded[j] - p;
+                        if (glm::dot(d, d) <= tolerance_squared) {
+                            match = j;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (match < 0) {
+            match = welded.size();
+            welded.push_back(p);
+            cells[CellKey(cx, cy, cz)].push_back(match);
+        }
+        remap[i] = match;
+    }
+    points = std::move(welded);
+    return remap;
+}
+
+// Signed distances of `a`'s vertices to the plane through `b`, with near-zero distances snapped to zero.
+static vec3 PlaneDistances(const vec3 *a, const vec3 *b, float epsilon) {
+    const vec3 n = glm::cross(b[1] - b[0], b[2] - b[0]);
+    const float scale = epsilon * glm::length(n);
+    vec3 d;
+    for (int i = 0; i < 3; ++i) {
+        d[i] = glm::dot(n, a[i] - b[0]);
+        if (std::abs(d[i]) < scale) d[i] = 0;
+    }
+    return d;
+}
+
+// Interval of the line parameter where a triangle crosses the other triangle's plane,
+// given its vertices' projections `p` onto the intersection line and signed distances `d` to the plane.
+static std::pair<float, float> CrossingInterval(const vec3 &p, const vec3 &d) {
+    // Find the vertex on its own side of the plane.
+    const int k = d[0] * d[1] > 0 ? 2 :
+        d[0] * d[2] > 0           ? 1 :
+        d[1] * d[2] > 0 || d[0] != 0 ? 0 :
+        d[1] != 0                    ? 1 :
+                                       2;
+    const int i = (k + 1) % 3, j = (k + 2) % 3;
+    const float ti = p[k] + (p[i] - p[k]) * d[k] / (d[k] - d[i]);
+    const float tj = p[k] + (p[j] - p[k]) * d[k] / (d[k] - d[j]);
+    return std::minmax(ti, tj);
+}
+
+// Möller's triangle-triangle intersection test.
+// Coplanar pairs are treated as non-intersecting, since overlapping coplanar faces are mostly duplicates, which are removed.
+static bool TrianglesIntersect(const vec3 *a, const vec3 *b) {
+    static constexpr float Epsilon = 1e-6;
+    const vec3 da = PlaneDistances(a, b, Epsilon);
+    if ((da[0] > 0 && da[1] > 0 && da[2] > 0) || (da[0] < 0 && da[1] < 0 && da[2] < 0)) return false;
+    if (da[0] == 0 && da[1] == 0 && da[2] == 0) return false;
+
+    const vec3 db = PlaneDistances(b, a, Epsilon);
+    if ((db[0] > 0 && db[1] > 0 && db[2] > 0) || (db[0] < 0 && db[1] < 0 && db[2] < 0)) return false;
+
+    // Project onto the largest axis of the intersection line direction, which preserves interval order.
+    const vec3 direction = glm::abs(glm::cross(glm::cross(a[1] - a[0], a[2] - a[0]), glm::cross(b[1] - b[0], b[2] - b[0])));
+    const int axis = direction.x > direction.y && direction.x > direction.z ? 0 : direction.y > direction.z ? 1 : 2;
+    const auto [a_min, a_max] = CrossingInterval({a[0][axis], a[1][axis], a[2][axis]}, da);
+    const auto [b_min, b_max] = CrossingInterval({b[0][axis], b[1][axis], b[2][axis]}, db);
+    return a_max >= b_min && b_max >= a_min;
+}
+
+static float BoundsDiagonal(const std::vector<vec3> &points) {
+    vec3 min = points[0], max = points[0];
+    for (const auto &p : points) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    return glm::length(max - min);
+}
+
+// Counts degenerate and duplicate faces of `triangle_indices`, with vertex indices mapped through `remap`,
+// and calls `keep(a, b, c)` for the remaining faces.
+template<typename Keep>
+static void ClassifyFaces(const std::vector<vec3> &points, const std::vector<uint> &triangle_indices, const std::vector<uint> &remap, float min_double_area, MeshRepair::Report &report, Keep &&keep) {
+    std::unordered_set<std::array<uint, 3>, FaceHash> face_keys;
+    face_keys.reserve(triangle_indices.size() / 3);
+    for (size_t f = 0; f < triangle_indices.size(); f += 3) {
+        const uint a = remap[triangle_indices[f]], b = remap[triangle_indices[f + 1]], c = remap[triangle_indices[f + 2]];
+        if (a == b || b == c || a == c || glm::length(glm::cross(points[b] - points[a], points[c] - points[a])) < min_double_area) {
+            report.DegenerateFaces++;
+            continue;
+        }
+        std::array<uint, 3> sorted{a, b, c};
+        std::sort(sorted.begin(), sorted.end());
+        if (!face_keys.insert(sorted).second) {
+            report.DuplicateFaces++;
+            continue;
+        }
+        keep(a, b, c);
+    }
+}
+
+// Count open and non-manifold edges, and intersecting pairs of faces that don't share a vertex.
+static void CheckEdgesAndIntersections(const std::vector<vec3> &points, const std::vector<uint> &triangle_indices, MeshRepair::Report &report) {
+    // Count faces per edge.
+    std::unordered_map<uint64_t, uint> edge_faces;
+    edge_faces.reserve(triangle_indices.size());
+    for (size_t f = 0; f < triangle_indices.size(); f += 3) {
+        for (int e = 0; e < 3; ++e) {
+            const uint a = triangle_indices[f + e], b = triangle_indices[f + (e + 1) % 3];
+            edge_faces[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+        }
+    }
+    for (const auto &[_, count] : edge_faces) {
+        if (count == 1) report.BoundaryEdges++;
+        else if (count > 2) report.NonManifoldEdges++;
+    }
+
+    const BVH bvh{points, triangle_indices};
+    const uint num_faces = triangle_indices.size() / 3;
+    std::atomic<uint> self_intersections = 0;
+    Scheduler::ParallelFor(0, num_faces, [&](uint begin, uint end) {
+        uint count = 0;
+        for (uint f = begin; f < end; ++f) {
+            const uint *fi = &triangle_indices[f * 3];
+            const vec3 a[3]{points[fi[0]], points[fi[1]], points[fi[2]]};
+            bvh.ForEachOverlapping(bvh.GetTriangleBounds(f), [&](uint g) {
+                if (g <= f) return;
+
+                const uint *gi = &triangle_indices[g * 3];
+                for (int i = 0; i < 3; ++i) {
+                    if (gi[i] == fi[0] || gi[i] == fi[1] || gi[i] == fi[2]) return;
+                }
+                const vec3 b[3]{points[gi[0]], points[gi[1]], points[gi[2]]};
+                if (TrianglesIntersect(a, b)) count++;
+            });
+        }
+        self_intersections += count;
+    });
+    report.SelfIntersections = self_intersections;
+}
+
+MeshRepair::Report MeshRepair::Repair(std::vector<vec3> &points, std::vector<uint> &triangle_indices, float relative_tolerance) {
+    Report report{.Repaired = true};
+    if (points.empty()) return report;
+
+    const float diagonal = BoundsDiagonal(points);
+    const uint num_points = points.size();
+    const auto remap = Weld(points, relative_tolerance * diagonal);
+    report.WeldedVertices = num_points - points.size();
+
+    // Remove degenerate and duplicate faces.
+    std::vector<uint> kept_indices;
+    kept_indices.reserve(triangle_indices.size());
+    const float min_double_area = relative_tolerance * diagonal * relative_tolerance * diagonal;
+    ClassifyFaces(points, triangle_indices, remap, min_double_area, report, [&](uint a, uint b, uint c) { kept_indices.insert(kept_indices.end(), {a, b, c}); });
+    triangle_indices = std::move(kept_indices);
+
+    // Drop vertices that are no longer referenced (TetGen would keep them as interior points).
+    std::vector<uint> compact(points.size(), ~0u);
+    std::vector<vec3> used_points;
+    used_points.reserve(points.size());
+    for (auto &i : triangle_indices) {
+        if (compact[i] == ~0u) {
+            compact[i] = used_points.size();
+            used_points.push_back(points[i]);
+        }
+        i = compact[i];
+    }
+    points = std::move(used_points);
+
+    CheckEdgesAndIntersections(points, triangle_indices, report);
+    return report;
+}
+
+MeshRepair::Report MeshRepair::Check(const std::vector<vec3> &points, const std::vector<uint> &triangle_indices, float relative_tolerance) {
+    Report report;
+    if (points.empty()) return report;
+
+    const float diagonal = BoundsDiagonal(points);
+    {
+        // Only the count is needed, so weld a copy of the points.
+        auto welded_points = points;
+        Weld(welded_points, relative_tolerance * diagonal);
+        report.WeldedVertices = points.size() - welded_points.size();
+    }
+
+    std::vector<uint> identity(points.size());
+    for (uint i = 0; i < identity.size(); ++i) identity[i] = i;
+    const float min_double_area = relative_tolerance * diagonal * relative_tolerance * diagonal;
+    ClassifyFaces(points, triangle_indices, identity, min_double_area, report, [](uint, uint, uint) {});
+
+    CheckEdgesAndIntersections(points, triangle_indices, report);
+    return report;
+}
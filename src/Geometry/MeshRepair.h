@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+// Cleanup and validation of triangle meshes before tetrahedralization.
+// TetGen needs a closed, manifold, non-self-intersecting surface, and tends to fail slowly (or produce garbage) otherwise.
+struct MeshRepair {
+    struct Report {
+        bool Repaired = false; // Whether the vertex and face problems below were fixed (by `Repair`), or only found (by `Check`).
+        uint WeldedVertices = 0; // Vertices coincident with an earlier vertex.
+        uint DegenerateFaces = 0; // Faces with repeated vertices or (near-)zero area.
+        uint DuplicateFaces = 0; // Faces with the same vertices as an earlier face, in either orientation.
+        uint BoundaryEdges = 0; // Edges with only one adjacent face.
+        uint NonManifoldEdges = 0; // Edges with more than two adjacent faces.
+        uint SelfIntersections = 0; // Pairs of non-adjacent faces that intersect.
+
+        bool IsWatertight() const { return BoundaryEdges == 0 && NonManifoldEdges == 0; }
+        bool IsValid() const { return IsWatertight() && SelfIntersections == 0; }
+        std::string Describe() const;
+    };
+
+    // Weld vertices closer than `relative_tolerance` times the bounding box diagonal (using a spatial hash),
+    // remove degenerate and duplicate faces and unreferenced vertices, then check for open boundaries,
+    // non-manifold edges and self-intersections (using a `BVH`).
+    // The mesh is modified in place. Problems that can't be repaired are only reported.
+    static Report Repair(std::vector<glm::vec3> &points, std::vector<uint> &triangle_indices, float relative_tolerance = 1e-6);
+    // Run the same checks as `Repair` on the mesh as-is, without modifying it.
+    // Coincident vertices aren't welded, so seams between them show up as boundary edges.
+    static Report Check(const std::vector<glm::vec3> &points, const std::vector<uint> &triangle_indices, float relative_tolerance = 1e-6);
+};
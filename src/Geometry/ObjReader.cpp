@@ -0,0 +1,177 @@
+#include "ObjReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include "MappedFile.h"
+#include "Scheduler.h"
+
+static constexpr size_t ChunkBytes = 1 << 20; // Target chunk size. Chunks end at the first line break after this.
+
+// A range of whole lines, and what was parsed from it.
+struct ObjChunk {
+    const char *Begin, *End;
+    uint NumPoints = 0, PointOffset = 0; // Points in this chunk, and in all chunks before it.
+    std::vector<uint> Indices, FaceSizes;
+};
+
+static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+static const char *SkipSpaces(const char *p, const char *end) {
+    while (p < end && IsSpace(*p)) ++p;
+    return p;
+}
+static const char *NextLine(const char *p, const char *end) {
+    const auto *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+// Pointer past the keyword if the line at `p` (after leading whitespace) starts with the single-character `keyword`.
+static const char *MatchKeyword(const char *p, const char *end, char keyword) {
+    return p + 1 < end && p[0] == keyword && IsSpace(p[1]) ? p + 2 : nullptr;
+}
+
+// Parse a decimal float at `p`, advancing past it.
+static bool ParseFloat(const char *&p, const char *end, float &value) {
+    if (p < end && *p == '+') ++p; // Not accepted by `from_chars`.
+#if __cpp_lib_to_chars >= 201611L
+    const auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec == std::errc::invalid_argument) return false;
+    if (ec == std::errc::result_out_of_range) value = 0; // Only denormals are this small in practice.
+    p = ptr;
+    return true;
+#else
+    // Some standard libraries (e.g. libc++ before 20) don't implement floating point `from_chars`.
+    // Accumulate up to 19 significant digits, and scale by the power of ten in double precision,
+    // which is exact to within float rounding for any coordinate written by a mesh exporter.
+    const char *s = p;
+    const bool negative = s < end && *s == '-';
+    if (negative) ++s;
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    bool any_digits = false;
+    for (; s < end && *s >= '0' && *s <= '9'; ++s, any_digits = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa != 0) ++digits;
+        } else {
+            ++exponent;
+        }
+    }
+    if (s < end && *s == '.') {
+        for (++s; s < end && *s >= '0' && *s <= '9'; ++s, any_digits = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa != 0) ++digits;
+                --exponent;
+            }
+        }
+    }
+    if (!any_digits) return false;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char *e = s + 1;
+        const bool negative_exponent = e < end && *e == '-';
+        if (e < end && (*e == '-' || *e == '+')) ++e;
+        int explicit_exponent = 0;
+        const auto [ptr, ec] = std::from_chars(e, end, explicit_exponent);
+        if (ec == std::errc{}) {
+            exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+            s = ptr;
+        }
+    }
+    const double magnitude = mantissa == 0 ? 0 : double(mantissa) * std::pow(10.0, exponent);
+    value = float(negative ? -magnitude : magnitude);
+    p = s;
+    return true;
+#endif
+}
+
+// Count the vertex lines, so each chunk knows the index of its first vertex before parsing faces with relative indices.
+static void CountPoints(ObjChunk &chunk) {
+    for (const char *line = chunk.Begin; line < chunk.End; line = NextLine(line, chunk.End)) {
+        if (MatchKeyword(SkipSpaces(line, chunk.End), chunk.End, 'v')) ++chunk.NumPoints;
+    }
+}
+
+static void ParseChunk(ObjChunk &chunk, glm::vec3 *points, uint total_points, const fs::path &path) {
+    const char *end = chunk.End;
+    uint point_index = chunk.PointOffset;
+    for (const char *line = chunk.Begin; line < end; line = NextLine(line, end)) {
+        const char *p = SkipSpaces(line, end);
+        if (const char *v = MatchKeyword(p, end, 'v')) {
+            auto &point = points[point_index++];
+            for (uint axis = 0; axis < 3; axis++) {
+                v = SkipSpaces(v, end);
+                if (!ParseFloat(v, end, point[axis])) throw std::runtime_error(std::format("Malformed vertex in {}.", path.string()));
+            }
+        } else if (const char *f = MatchKeyword(p, end, 'f')) {
+            uint face_size = 0;
+            for (f = SkipSpaces(f, end); f < end && *f != '\n'; f = SkipSpaces(f, end)) {
+                // Vertex references are `v`, `v/vt`, `v//vn` or `v/vt/vn`. Only `v` is used.
+                int index = 0;
+                const auto [ptr, ec] = std::from_chars(f, end, index);
+                if (ec != std::errc{} || index == 0) throw std::runtime_error(std::format("Malformed face in {}.", path.string()));
+                // Negative indices are relative to the last vertex so far.
+                const int64_t resolved = index > 0 ? int64_t(index) - 1 : int64_t(point_index) + index;
+                if (resolved < 0 || resolved >= total_points) throw std::runtime_error(std::format("Face vertex index {} is out of range in {}.", index, path.string()));
+                chunk.Indices.push_back(uint(resolved));
+                ++face_size;
+                for (f = ptr; f < end && !IsSpace(*f) && *f != '\n';) ++f;
+            }
+            if (face_size >= 3) {
+                chunk.FaceSizes.push_back(face_size);
+            } else {
+                chunk.Indices.resize(chunk.Indices.size() - face_size); // Points and lines aren't faces.
+            }
+        }
+    }
+}
+
+ObjReader::Polygons ObjReader::Read(const fs::path &path) {
+    const MappedFile file{path};
+    const auto bytes = file.Bytes();
+    const char *const begin = reinterpret_cast<const char *>(bytes.data()), *const end = begin + bytes.size();
+
+    std::vector<ObjChunk> chunks;
+    for (const char *chunk_begin = begin; chunk_begin < end;) {
+        const char *chunk_end = size_t(end - chunk_begin) <= ChunkBytes ? end : NextLine(chunk_begin + ChunkBytes, end);
+        chunks.push_back({chunk_begin, chunk_end});
+        chunk_begin = chunk_end;
+    }
+    const uint num_chunks = chunks.size();
+
+    Scheduler::ParallelFor(0, num_chunks, [&](uint chunk_begin, uint chunk_end) {
+        for (uint i = chunk_begin; i < chunk_end; ++i) CountPoints(chunks[i]);
+    }, 1);
+    uint total_points = 0;
+    for (auto &chunk : chunks) {
+        chunk.PointOffset = total_points;
+        total_points += chunk.NumPoints;
+    }
+
+    // Points are written straight into place. Faces are collected per chunk, since their sizes aren't known until parsed.
+    Polygons polygons;
+    polygons.Points.resize(total_points);
+    Scheduler::ParallelFor(0, num_chunks, [&](uint chunk_begin, uint chunk_end) {
+        for (uint i = chunk_begin; i < chunk_end; ++i) ParseChunk(chunks[i], polygons.Points.data(), total_points, path);
+    }, 1);
+
+    std::vector<size_t> index_offsets(num_chunks + 1, 0), face_offsets(num_chunks + 1, 0);
+    for (uint i = 0; i < num_chunks; ++i) {
+        index_offsets[i + 1] = index_offsets[i] + chunks[i].Indices.size();
+        face_offsets[i + 1] = face_offsets[i] + chunks[i].FaceSizes.size();
+    }
+    polygons.Indices.resize(index_offsets.back());
+    polygons.FaceSizes.resize(face_offsets.back());
+    Scheduler::ParallelFor(0, num_chunks, [&](uint chunk_begin, uint chunk_end) {
+        for (uint i = chunk_begin; i < chunk_end; ++i) {
+            std::copy(chunks[i].Indices.begin(), chunks[i].Indices.end(), polygons.Indices.begin() + index_offsets[i]);
+            std::copy(chunks[i].FaceSizes.begin(), chunks[i].FaceSizes.end(), polygons.FaceSizes.begin() + face_offsets[i]);
+        }
+    }, 1);
+    return polygons;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+namespace fs = std::filesystem;
+
+// Fast reader for the geometry in Wavefront OBJ files, for large (e.g. scanned) meshes.
+// The file is memory-mapped and split into chunks at line boundaries, which are parsed in parallel on the `Scheduler`.
+// Only vertex positions (`v`) and faces (`f`) are read. Texture coordinates, normals, groups and materials are ignored.
+struct ObjReader {
+    struct Polygons {
+        std::vector<glm::vec3> Points;
+        std::vector<uint> Indices; // Vertex indices of all faces, concatenated.
+        std::vector<uint> FaceSizes; // Number of vertices in each face.
+    };
+
+    // Throws `std::runtime_error` if the file can't be read or has malformed vertex or face lines.
+    static Polygons Read(const fs::path &);
+};
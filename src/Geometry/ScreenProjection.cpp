@@ -0,0 +1,149 @@
+#include "ScreenProjection.h"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace ScreenProjection {
+Points::Points(std::span<const glm::vec3> points) : Size(points.size()) {
+    const size_t padded_size = (points.size() + Lanes - 1) / Lanes * Lanes;
+    X.resize(padded_size, 0);
+    Y.resize(padded_size, 0);
+    Z.resize(padded_size, 0);
+    for (size_t i = 0; i < points.size(); ++i) {
+        X[i] = points[i].x;
+        Y[i] = points[i].y;
+        Z[i] = points[i].z;
+    }
+}
+
+// One batch of projected points.
+struct Batch {
+    float X[Lanes], Y[Lanes]; // Screen position (pixels)
+    float Depth[Lanes]; // View-space depth (clip w). Increases away from the camera.
+    int Visible[Lanes]; // Nonzero inside the view frustum, and not padding. As wide as the floats, so lane loops vectorize at full width.
+};
+
+// Project the batch of points starting at `base`. Inlined, so the batch stays in registers in the query loops.
+// Explicit AVX2 (one 8-wide vector) and AArch64 NEON (two 4-wide vectors) kernels, with a portable lane loop otherwise.
+// All compute the same operations in the same order.
+#if defined(__AVX2__)
+static inline void Project(const Points &points, uint base, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, Batch &batch) {
+    static_assert(Lanes == 8);
+    const glm::mat4 m = model_view_projection;
+    const __m256 x = _mm256_loadu_ps(&points.X[base]), y = _mm256_loadu_ps(&points.Y[base]), z = _mm256_loadu_ps(&points.Z[base]);
+    const auto clip = [&](uint row) {
+        const __m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m[0][row]), x), _mm256_mul_ps(_mm256_set1_ps(m[1][row]), y));
+        return _mm256_add_ps(_mm256_add_ps(xy, _mm256_mul_ps(_mm256_set1_ps(m[2][row]), z)), _mm256_set1_ps(m[3][row]));
+    };
+    const __m256 cx = clip(0), cy = clip(1), cz = clip(2), cw = clip(3);
+    const __m256 half = _mm256_set1_ps(0.5f), half_inv_w = _mm256_div_ps(half, cw);
+    _mm256_storeu_ps(batch.X, _mm256_mul_ps(_mm256_add_ps(half, _mm256_mul_ps(cx, half_inv_w)), _mm256_set1_ps(viewport_size.x)));
+    _mm256_storeu_ps(batch.Y, _mm256_mul_ps(_mm256_sub_ps(half, _mm256_mul_ps(cy, half_inv_w)), _mm256_set1_ps(viewport_size.y)));
+    _mm256_storeu_ps(batch.Depth, cw);
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const auto within_w = [&](__m256 c) { return _mm256_cmp_ps(_mm256_and_ps(c, abs_mask), cw, _CMP_LE_OQ); };
+    const __m256i index = _mm256_add_epi32(_mm256_set1_epi32(int(base)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256 not_padding = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(int(points.Size)), index));
+    __m256 visible = _mm256_and_ps(_mm256_cmp_ps(cw, _mm256_setzero_ps(), _CMP_GT_OQ), not_padding);
+    visible = _mm256_and_ps(_mm256_and_ps(visible, within_w(cx)), _mm256_and_ps(within_w(cy), within_w(cz)));
+    const int visible_bits = _mm256_movemask_ps(visible);
+    for (uint l = 0; l < Lanes; ++l) batch.Visible[l] = (visible_bits >> l) & 1;
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+static inline void Project(const Points &points, uint base, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, Batch &batch) {
+    static_assert(Lanes % 4 == 0);
+    const glm::mat4 m = model_view_projection;
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    static constexpr uint32_t LaneOffsets[4]{0, 1, 2, 3};
+    for (uint h = 0; h < Lanes; h += 4) {
+        const float32x4_t x = vld1q_f32(&points.X[base + h]), y = vld1q_f32(&points.Y[base + h]), z = vld1q_f32(&points.Z[base + h]);
+        const auto clip = [&](uint row) {
+            const float32x4_t xy = vaddq_f32(vmulq_n_f32(x, m[0][row]), vmulq_n_f32(y, m[1][row]));
+            return vaddq_f32(vaddq_f32(xy, vmulq_n_f32(z, m[2][row])), vdupq_n_f32(m[3][row]));
+        };
+        const float32x4_t cx = clip(0), cy = clip(1), cz = clip(2), cw = clip(3);
+        const float32x4_t half_inv_w = vdivq_f32(half, cw);
+        vst1q_f32(batch.X + h, vmulq_n_f32(vaddq_f32(half, vmulq_f32(cx, half_inv_w)), viewport_size.x));
+        vst1q_f32(batch.Y + h, vmulq_n_f32(vsubq_f32(half, vmulq_f32(cy, half_inv_w)), viewport_size.y));
+        vst1q_f32(batch.Depth + h, cw);
+
+        const uint32x4_t index = vaddq_u32(vdupq_n_u32(base + h), vld1q_u32(LaneOffsets));
+        uint32x4_t visible = vandq_u32(vcgtq_f32(cw, vdupq_n_f32(0)), vcltq_u32(index, vdupq_n_u32(points.Size)));
+        visible = vandq_u32(visible, vandq_u32(vcleq_f32(vabsq_f32(cx), cw), vandq_u32(vcleq_f32(vabsq_f32(cy), cw), vcleq_f32(vabsq_f32(cz), cw))));
+        uint32_t visible_lanes[4];
+        vst1q_u32(visible_lanes, visible);
+        for (uint l = 0; l < 4; ++l) batch.Visible[h + l] = visible_lanes[l] != 0;
+    }
+}
+#else
+static inline void Project(const Points &points, uint base, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, Batch &batch) {
+    const glm::mat4 m = model_view_projection; // Local copy, so it's known not to alias the outputs.
+    const float *x = &points.X[base], *y = &points.Y[base], *z = &points.Z[base];
+    for (uint l = 0; l < Lanes; ++l) {
+        const float cx = m[0][0] * x[l] + m[1][0] * y[l] + m[2][0] * z[l] + m[3][0];
+        const float cy = m[0][1] * x[l] + m[1][1] * y[l] + m[2][1] * z[l] + m[3][1];
+        const float cz = m[0][2] * x[l] + m[1][2] * y[l] + m[2][2] * z[l] + m[3][2];
+        const float cw = m[0][3] * x[l] + m[1][3] * y[l] + m[2][3] * z[l] + m[3][3];
+        const float half_inv_w = 0.5f / cw;
+        batch.X[l] = (0.5f + cx * half_inv_w) * viewport_size.x;
+        batch.Y[l] = (0.5f - cy * half_inv_w) * viewport_size.y;
+        batch.Depth[l] = cw;
+        batch.Visible[l] = (cw > 0) & (std::abs(cx) <= cw) & (std::abs(cy) <= cw) & (std::abs(cz) <= cw) & (base + l < points.Size);
+    }
+}
+#endif
+
+int FindNearestWithin(const Points &points, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, glm::vec2 screen_point, float radius) {
+    // Track the nearest point per lane, and reduce across lanes at the end.
+    float nearest_depth[Lanes];
+    int nearest_index[Lanes];
+    for (uint l = 0; l < Lanes; ++l) {
+        nearest_depth[l] = FLT_MAX;
+        nearest_index[l] = -1;
+    }
+    const float radius_squared = radius * radius;
+    Batch batch;
+    for (uint base = 0; base < points.Size; base += Lanes) {
+        Project(points, base, model_view_projection, viewport_size, batch);
+        for (uint l = 0; l < Lanes; ++l) {
+            const float dx = batch.X[l] - screen_point.x, dy = batch.Y[l] - screen_point.y;
+            const bool nearer = batch.Visible[l] & (dx * dx + dy * dy <= radius_squared) & (batch.Depth[l] < nearest_depth[l]);
+            nearest_depth[l] = nearer ? batch.Depth[l] : nearest_depth[l];
+            nearest_index[l] = nearer ? int(base + l) : nearest_index[l];
+        }
+    }
+
+    int nearest = -1;
+    float min_depth = FLT_MAX;
+    for (uint l = 0; l < Lanes; ++l) {
+        if (nearest_index[l] >= 0 && (nearest_depth[l] < min_depth || (nearest_depth[l] == min_depth && nearest_index[l] < nearest))) {
+            min_depth = nearest_depth[l];
+            nearest = nearest_index[l];
+        }
+    }
+    return nearest;
+}
+
+std::vector<uint> FindWithin(const Points &points, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, glm::vec2 min, glm::vec2 max) {
+    std::vector<uint> indices;
+    Batch batch;
+    for (uint base = 0; base < points.Size; base += Lanes) {
+        Project(points, base, model_view_projection, viewport_size, batch);
+        bool inside[Lanes];
+        for (uint l = 0; l < Lanes; ++l) {
+            inside[l] = batch.Visible[l] & (batch.X[l] >= min.x) & (batch.X[l] <= max.x) & (batch.Y[l] >= min.y) & (batch.Y[l] <= max.y);
+        }
+        for (uint l = 0; l < Lanes; ++l) {
+            if (inside[l]) indices.push_back(base + l);
+        }
+    }
+    return indices;
+}
+} // namespace ScreenProjection
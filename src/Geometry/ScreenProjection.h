@@ -0,0 +1,34 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+using uint = unsigned int;
+
+// Batched projection of points to screen space, for CPU-side screen queries (hover, box selection, ...).
+// Points are processed `Lanes` at a time, from a structure-of-arrays copy of their positions.
+// Projection uses AVX2 when the build targets it (e.g. `-mavx2`), NEON on AArch64 (e.g. Apple silicon),
+// and otherwise a fixed-size lane loop without branches, which compilers can vectorize for the target.
+namespace ScreenProjection {
+inline constexpr uint Lanes = 8;
+
+// Point positions in structure-of-arrays layout, zero-padded to a multiple of `Lanes`.
+struct Points {
+    Points(std::span<const glm::vec3>);
+
+    std::vector<float> X, Y, Z;
+    uint Size; // Number of points, excluding padding.
+};
+
+// Screen coordinates are in pixels, from the top-left of a `viewport_size` viewport (like ImGui).
+// Points outside the view frustum are culled.
+
+// Index of the point within `radius` pixels of `screen_point` nearest to the camera, or -1 for none.
+int FindNearestWithin(const Points &, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, glm::vec2 screen_point, float radius);
+// Indices of the points inside the screen rectangle [`min`, `max`], ascending.
+std::vector<uint> FindWithin(const Points &, const glm::mat4 &model_view_projection, glm::vec2 viewport_size, glm::vec2 min, glm::vec2 max);
+} // namespace ScreenProjection
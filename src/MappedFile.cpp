@@ -0,0 +1,35 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const fs::path &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error(std::format("Failed to open {}: {}", path.string(), strerror(errno)));
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error(std::format("Failed to read size of {}: {}", path.string(), strerror(errno)));
+    }
+    Size = file_stat.st_size;
+    if (Size > 0) {
+        void *data = mmap(nullptr, Size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(std::format("Failed to map {}: {}", path.string(), strerror(errno)));
+        }
+        Data = static_cast<const std::byte *>(data);
+    }
+    close(fd); // The mapping stays valid after the descriptor is closed.
+}
+
+MappedFile::~MappedFile() {
+    if (Data) munmap(const_cast<std::byte *>(Data), Size);
+}
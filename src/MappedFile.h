@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace fs = std::filesystem;
+
+// Read-only memory mapping of an entire file.
+// Pages are loaded lazily on first access, and shared between all processes mapping the same file.
+struct MappedFile {
+    MappedFile(const fs::path &); // Throws `std::runtime_error` if the file can't be opened or mapped.
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::span<const std::byte> Bytes() const { return {Data, Size}; }
+
+private:
+    const std::byte *Data = nullptr;
+    size_t Size = 0;
+};
+
+// View the next `count` elements of type `T` at `cursor` in place, and advance `cursor` past them.
+// The caller checks the bounds, and that `cursor` is suitably aligned for `T`.
+template<typename T> std::span<const T> TakeSpan(const std::byte *&cursor, size_t count) {
+    const std::span<const T> span{reinterpret_cast<const T *>(cursor), count};
+    cursor += count * sizeof(T);
+    return span;
+}
@@ -1,5 +1,12 @@
 #include "InteractiveMesh.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <numeric>
+
 #include "date.h"
 #include "mesh2faust.h"
 #include "tetMesh.h" // Vega
@@ -7,14 +14,143 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include "Audio.h"
+#include "Cache.h"
+#include "MappedFile.h"
+#include "ModalModel.h"
 #include "RealImpact.h"
 
 #include "Geometry/ConvexHull.h"
+#include "Geometry/Decimation.h"
+#include "Geometry/MeshRepair.h"
 
 using glm::vec3, glm::vec4, glm::mat4;
 using seconds_t = std::chrono::time_point<std::chrono::system_clock, std::chrono::seconds>; // Alias for epoch seconds.
 
-InteractiveMesh::InteractiveMesh(::Scene &scene, fs::path file_path) : Mesh(), Scene(scene) {
+static constexpr float VertexHoverRadius = 5.f; // Pixels
+
+// Only surface vertices can be struck, so they're the only excitation candidates.
+// Returns the unique vertex indices of the tets' boundary triangles, ascending.
+static std::vector<int> TetSurfaceVertices(const tetgenio &tets) {
+    std::vector<int> vertices(tets.trifacelist, tets.trifacelist + tets.numberoftrifaces * 3);
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    return vertices;
+}
+
+// Linearly sample `count` of the `num_candidates` excitation candidates. Returns indices into the candidates.
+static std::vector<uint> SampleExcitationCandidates(int count, uint num_candidates) {
+    if (num_candidates == 0 || count <= 0) return {};
+
+    std::vector<uint> samples(count);
+    for (int i = 0; i < count; i++) {
+        const float t = count > 1 ? float(i) / (count - 1) : 0;
+        samples[i] = uint(t * (num_candidates - 1));
+    }
+    return samples;
+}
+
+// Processed geometry cache entry (.m2a): A `GeometryCacheHeader`, followed by two polygon meshes:
+// the centered polyhedron, and its convex hull (empty if it hadn't been generated when the entry was written).
+// Each is stored as points, vertex normals and face normals (xyz `float`s), face sizes, and face vertex indices (`uint`s).
+// All arrays are 4-byte aligned, so they're used in place from a mapping of the file.
+struct GeometryCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t NumPoints[2], NumFaces[2], NumFaceIndices[2];
+};
+static constexpr char GeometryCacheMagic[4]{'M', '2', 'A', 'M'};
+static constexpr uint32_t GeometryCacheVersion = 1;
+
+// Keyed by the source file's identity rather than its content, so a cache hit doesn't need to read the source file.
+static uint64_t GeometryCacheKey(const fs::path &file_path) {
+    Cache::Hasher hasher;
+    hasher.Add(GeometryCacheVersion)
+        .Add(fs::absolute(file_path).string())
+        .Add(uint64_t(fs::file_size(file_path)))
+        .Add(int64_t(fs::last_write_time(file_path).time_since_epoch().count()));
+    if (file_path.extension() == ".svg") hasher.Add(MeshProfile::NumRadialSlices).Add(MeshProfile::ClosePath);
+    return hasher.Hash;
+}
+
+static bool LoadCachedGeometry(const fs::path &path, Geometry &polyhedron, Geometry &convex_hull) {
+    if (!fs::exists(path)) return false;
+
+    // An unreadable entry is a cache miss, like a corrupt one.
+    std::unique_ptr<const MappedFile> file;
+    try {
+        file = std::make_unique<const MappedFile>(path);
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to read geometry cache entry " << path << ": " << e.what() << '\n';
+        return false;
+    }
+    const auto bytes = file->Bytes();
+    GeometryCacheHeader header;
+    if (bytes.size() < sizeof(header)) return false;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.Magic, GeometryCacheMagic, sizeof(GeometryCacheMagic)) != 0 || header.Version != GeometryCacheVersion) return false;
+
+    size_t num_elements = 0; // 4-byte elements
+    for (uint i = 0; i < 2; i++) num_elements += size_t(header.NumPoints[i]) * 6 + size_t(header.NumFaces[i]) * 4 + header.NumFaceIndices[i];
+    if (bytes.size() != sizeof(header) + num_elements * 4) return false;
+
+    const std::byte *cursor = bytes.data() + sizeof(header);
+    Geometry *geometries[]{&polyhedron, &convex_hull};
+    for (uint i = 0; i < 2; i++) {
+        const auto points = TakeSpan<vec3>(cursor, header.NumPoints[i]);
+        const auto vertex_normals = TakeSpan<vec3>(cursor, header.NumPoints[i]);
+        const auto face_normals = TakeSpan<vec3>(cursor, header.NumFaces[i]);
+        const auto face_sizes = TakeSpan<uint>(cursor, header.NumFaces[i]);
+        const auto indices = TakeSpan<uint>(cursor, header.NumFaceIndices[i]);
+        // Don't let a corrupt entry index out of bounds.
+        if (std::accumulate(face_sizes.begin(), face_sizes.end(), size_t(0)) != indices.size()) return false;
+        if (std::any_of(indices.begin(), indices.end(), [&](uint index) { return index >= points.size(); })) return false;
+        if (!points.empty()) geometries[i]->SetPolygons(points, face_sizes, indices, vertex_normals, face_normals);
+    }
+    return true;
+}
+
+static void SaveCachedGeometry(const fs::path &path, const Geometry &polyhedron, const Geometry &convex_hull) {
+    GeometryCacheHeader header{.Version = GeometryCacheVersion};
+    std::memcpy(header.Magic, GeometryCacheMagic, sizeof(GeometryCacheMagic));
+    const Geometry *geometries[]{&polyhedron, &convex_hull};
+    for (uint i = 0; i < 2; i++) {
+        const auto &mesh = geometries[i]->GetMesh();
+        header.NumPoints[i] = mesh.n_vertices();
+        header.NumFaces[i] = mesh.n_faces();
+        header.NumFaceIndices[i] = 0;
+        for (const auto &fh : mesh.faces()) header.NumFaceIndices[i] += mesh.valence(fh);
+    }
+
+    const auto tmp_path = Cache::TempPath(path);
+    bool written;
+    {
+        std::ofstream file(tmp_path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        const auto write_vec3 = [&file](const OpenMesh::Vec3f &v) { file.write(reinterpret_cast<const char *>(v.data()), sizeof(float) * 3); };
+        for (const auto *geometry : geometries) {
+            const auto &mesh = geometry->GetMesh();
+            for (const auto &vh : mesh.vertices()) write_vec3(mesh.point(vh));
+            for (const auto &vh : mesh.vertices()) write_vec3(mesh.normal(vh));
+            for (const auto &fh : mesh.faces()) write_vec3(mesh.normal(fh));
+            for (const auto &fh : mesh.faces()) {
+                const uint32_t valence = mesh.valence(fh);
+                file.write(reinterpret_cast<const char *>(&valence), sizeof(valence));
+            }
+            for (const auto &fh : mesh.faces()) {
+                for (const auto &vh : mesh.fv_range(fh)) {
+                    const uint32_t index = vh.idx();
+                    file.write(reinterpret_cast<const char *>(&index), sizeof(index));
+                }
+            }
+        }
+        file.close();
+        written = bool(file);
+        if (!written) std::cerr << "Failed to write geometry cache entry " << tmp_path << '\n';
+    }
+    Cache::CommitEntry(tmp_path, path, written);
+}
+
+InteractiveMesh::InteractiveMesh(::Scene &scene, fs::path file_path) : Mesh(), Scene(scene), VoiceId(Audio::FaustState::CreateVoice()) {
     ExcitableVertexArrows.Generate();
     HoveredVertexArrow.Generate();
 
@@ -23,12 +159,18 @@ InteractiveMesh::InteractiveMesh(::Scene &scene, fs::path file_path) : Mesh(), S
     if (!is_svg && !is_obj) throw std::runtime_error("Unsupported file type: " + file_path.string());
 
     FilePath = file_path; // Store the most recent file path.
-    if (is_svg) {
-        Profile = std::make_unique<MeshProfile>(FilePath);
-        Polyhedron.ExtrudeProfile(Profile->GetVertices(), Profile->NumRadialSlices, Profile->ClosePath);
-    } else {
-        Polyhedron.Load(FilePath);
-        Polyhedron.Center();
+    if (is_svg) Profile = std::make_unique<MeshProfile>(FilePath);
+    // Reopening a file skips parsing, extrusion, centering and normal computation.
+    GeometryCacheEntry = UseCache && fs::exists(FilePath) ? Cache::EntryPath("geometry", GeometryCacheKey(FilePath), "m2a") : fs::path{};
+    if (GeometryCacheEntry.empty() || !LoadCachedGeometry(GeometryCacheEntry, Polyhedron, ConvexHull)) {
+        bool loaded = true;
+        if (is_svg) {
+            Polyhedron.ExtrudeProfile(Profile->GetVertices(), Profile->NumRadialSlices, Profile->ClosePath);
+        } else {
+            loaded = Polyhedron.Load(FilePath);
+            Polyhedron.Center();
+        }
+        if (!GeometryCacheEntry.empty() && loaded) SaveCachedGeometry(GeometryCacheEntry, Polyhedron, ConvexHull);
     }
 
     HoveredVertexArrow.SetColor({1, 0, 0, 1});
@@ -36,18 +178,29 @@ InteractiveMesh::InteractiveMesh(::Scene &scene, fs::path file_path) : Mesh(), S
     InitialBounds = Polyhedron.ComputeBounds();
 
     Scene.AddMesh(this);
-    Scene.AddMesh(&ExcitableVertexArrows);
-    Scene.AddMesh(&HoveredVertexArrow);
+    Scene.AddMesh(&ExcitableVertexArrows, true);
+    Scene.AddMesh(&HoveredVertexArrow, true);
+    Select();
     Scene.SetCameraDistance(glm::distance(InitialBounds.first, InitialBounds.second) * 2);
 }
 
 InteractiveMesh::~InteractiveMesh() {
+    // Stage tasks only touch the shared build state, so a running build can wind down on its own, without blocking the UI thread.
+    if (Build) Build->Progress.RequestCancel();
     Scene.RemoveMesh(this);
     Scene.RemoveMesh(&ExcitableVertexArrows);
     Scene.RemoveMesh(&HoveredVertexArrow);
+    Scene.RemoveMesh(&RealImpactListenerPoints);
+    if (Scene.PickMesh == this) {
+        Scene.PickMesh = nullptr;
+        Scene.ShowGizmo = false;
+        Scene.GizmoCallback = nullptr; // Only the selected mesh binds the gizmo.
+    }
 
     ExcitableVertexArrows.Delete();
     HoveredVertexArrow.Delete();
+
+    Audio::FaustState::DestroyVoice(VoiceId);
 }
 
 void InteractiveMesh::Generate() {
@@ -68,8 +221,9 @@ void InteractiveMesh::SetGeometryMode(GeometryMode mode) {
     ActiveGeometryMode = mode;
     if (ActiveGeometryMode == GeometryMode_ConvexHull && !HasConvexHull()) {
         ConvexHull.SetOpenMesh(ConvexHull::Generate(Polyhedron.GetVertices(), Polyhedron.NumVertices(), ConvexHull::Mode::RP3D));
+        if (UseCache && !GeometryCacheEntry.empty()) SaveCachedGeometry(GeometryCacheEntry, Polyhedron, ConvexHull);
     } else if (ActiveGeometryMode == GeometryMode_Tets && !HasTets()) {
-        TetGenerator.Launch();
+        BuildModel(ModelStage_Tets);
     }
     EnableVertexAttributes();
 }
@@ -89,6 +243,18 @@ void InteractiveMesh::ApplyTransform() {
     Scene.GizmoTransform = transform;
 }
 
+void InteractiveMesh::SetTranslation(const vec3 &translation) {
+    Translation = translation;
+    ApplyTransform();
+}
+
+void InteractiveMesh::Select() {
+    Scene.PickMesh = this;
+    Scene.PickRadius = VertexHoverRadius;
+    Scene.ShowGizmo = false;
+    Scene.GizmoCallback = nullptr;
+}
+
 void InteractiveMesh::ExtrudeProfile() {
     if (Profile == nullptr) return;
 
@@ -96,6 +262,8 @@ void InteractiveMesh::ExtrudeProfile() {
     Tets.Clear();
     UpdateExcitableVertices();
     Polyhedron.ExtrudeProfile(Profile->GetVertices(), Profile->NumRadialSlices, Profile->ClosePath);
+    SurfaceChanged = true;
+    GeometryCacheEntry.clear(); // The polyhedron no longer matches the source file.
     SetGeometryMode(GeometryMode_Poly);
 }
 
@@ -104,36 +272,77 @@ static vec4 Interpolate(const vec4 &a, const vec4 &b, float interpolation) {
 }
 
 void InteractiveMesh::UpdateExcitableVertexColors() {
-    if (ActiveGeometryMode != GeometryMode_Tets || !ShowExcitableVertices || ExcitableVertexIndices.empty()) return;
+    if (ActiveGeometryMode != GeometryMode_Tets || !ShowExcitableVertices || ExcitableVertexIndices.empty()) {
+        ExcitableVertexArrows.HighlightedInstance = -1;
+        return;
+    }
 
-    for (size_t i = 0; i < ExcitableVertexIndices.size(); i++) {
-        static const vec4 DisabledExcitableVertexColor = {0.3, 0.3, 0.3, 1}; // For when DSP has not been initialized.
-        static const vec4 ExcitableVertexColor = {1, 1, 1, 1}; // Based on `NumExcitableVertices`.
-        static const vec4 ActiveExciteVertexColor = {0, 1, 0, 1}; // The most recent excited vertex.
-        static const vec4 ExcitedVertexBaseColor = {1, 0, 0, 1}; // The color of the excited vertex when the gate has abs value of 1.
+    static const vec4 DisabledExcitableVertexColor = {0.3, 0.3, 0.3, 1}; // For when DSP has not been initialized.
+    static const vec4 ExcitableVertexColor = {1, 1, 1, 1}; // Based on `NumExcitableVertices`.
+    static const vec4 ActiveExciteVertexColor = {0, 1, 0, 1}; // The most recent excited vertex.
+    static const vec4 ExcitedVertexBaseColor = {1, 0, 0, 1}; // The color of the excited vertex when the gate has abs value of 1.
+
+    // Instance colors only change when the DSP starts or stops.
+    // The excited vertex changes every frame while playing, so it's drawn with the highlight uniform instead.
+    const bool is_running = Audio::FaustState::IsRunning(VoiceId);
+    const vec4 &base_color = is_running ? ExcitableVertexColor : DisabledExcitableVertexColor;
+    if (ExcitableVertexArrows.GetColor(0) != base_color) ExcitableVertexArrows.SetColor(base_color);
+
+    const auto excite_state = is_running ? Audio::FaustState::GetExciteState(VoiceId) : std::nullopt;
+    if (excite_state && excite_state->Pos >= 0 && excite_state->Pos < int(ExcitableVertexIndices.size())) {
+        ExcitableVertexArrows.HighlightedInstance = excite_state->Pos;
+        ExcitableVertexArrows.HighlightColor = Interpolate(ActiveExciteVertexColor, ExcitedVertexBaseColor, std::min(1.f, std::abs(excite_state->Value)));
+    } else {
+        ExcitableVertexArrows.HighlightedInstance = -1;
+    }
+}
 
-        vec4 color = !Audio::FaustState::IsRunning() ?
-            DisabledExcitableVertexColor :
-            Audio::FaustState::ExcitePos != nullptr && int(i) == int(*Audio::FaustState::ExcitePos) ?
-            Interpolate(ActiveExciteVertexColor, ExcitedVertexBaseColor, std::min(1.f, std::abs(*Audio::FaustState::ExciteValue))) :
-            ExcitableVertexColor;
-        ExcitableVertexArrows.SetColor(i, std::move(color));
+// Outward normals of a model's tet mesh vertices, from its boundary triangles. Zero for interior vertices.
+static std::vector<vec3> ComputeTetVertexNormals(const ModalModel &model) {
+    const auto *points = reinterpret_cast<const vec3 *>(model.TetVertices.data());
+    std::vector<vec3> normals(model.TetVertices.size() / 3, vec3{0});
+    const auto &triangles = model.SurfaceTriangles;
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+        // TetGen winds boundary triangles inward (see `UpdateTets`).
+        const uint a = triangles[i + 2], b = triangles[i + 1], c = triangles[i];
+        const vec3 face_normal = glm::cross(points[b] - points[a], points[c] - points[a]); // Area-weighted.
+        normals[a] += face_normal;
+        normals[b] += face_normal;
+        normals[c] += face_normal;
     }
+    return normals;
 }
 
 void InteractiveMesh::UpdateExcitableVertices() {
     ExcitableVertexIndices.clear();
-    if (!HasTets()) {
+    ExcitableVertexTree.reset();
+
+    std::vector<vec3> excitable_points, excitable_normals;
+    if (LoadedModel) {
+        // The loaded model's excitation positions, on the tet mesh it was computed from.
+        const auto &model = *LoadedModel;
+        const auto *points = reinterpret_cast<const vec3 *>(model.TetVertices.data());
+        const auto normals = ComputeTetVertexNormals(model);
+        ExcitableVertexIndices.assign(model.ExcitableVertices.begin(), model.ExcitableVertices.end());
+        for (const int vi : ExcitableVertexIndices) {
+            excitable_points.push_back(points[vi]);
+            excitable_normals.push_back(normals[vi]);
+        }
+    } else if (HasTets()) {
+        // Same as the model build's excitation positions.
+        for (const uint candidate : SampleExcitationCandidates(NumExcitableVertices, TetSurfaceVertexIndices.size())) {
+            ExcitableVertexIndices.push_back(TetSurfaceVertexIndices[candidate]);
+        }
+        for (const int vi : ExcitableVertexIndices) {
+            excitable_points.push_back(Tets.GetVertex(vi));
+            excitable_normals.push_back(Tets.GetVertexNormal(vi));
+        }
+    }
+    if (ExcitableVertexIndices.empty()) {
         ExcitableVertexArrows.ClearInstances();
         return;
     }
-
-    // Linearly sample excitable vertices from all available vertices.
-    ExcitableVertexIndices.resize(NumExcitableVertices);
-    for (int i = 0; i < NumExcitableVertices; i++) {
-        const float t = float(i) / (NumExcitableVertices - 1);
-        ExcitableVertexIndices[i] = int(t * (Tets.NumVertices() - 1));
-    }
+    ExcitableVertexTree.emplace(excitable_points);
 
     std::vector<mat4> transforms;
     std::vector<vec4> colors;
@@ -143,9 +352,10 @@ void InteractiveMesh::UpdateExcitableVertices() {
     // Point arrows at each excitable vertex.
     float scale_factor = 0.1f * glm::distance(InitialBounds.first, InitialBounds.second);
     mat4 scale = glm::scale(I, vec3{scale_factor});
-    for (auto vertex_index : ExcitableVertexIndices) {
-        mat4 translate = glm::translate(I, Tets.GetVertex(vertex_index));
-        mat4 rotate = glm::mat4_cast(glm::rotation(Up, glm::normalize(Tets.GetVertexNormal(vertex_index))));
+    for (uint i = 0; i < excitable_points.size(); ++i) {
+        const vec3 &normal = excitable_normals[i];
+        mat4 translate = glm::translate(I, excitable_points[i]);
+        mat4 rotate = glm::mat4_cast(glm::rotation(Up, glm::length(normal) > 0 ? glm::normalize(normal) : Up));
         transforms.push_back({translate * rotate * scale});
         colors.push_back({1, 1, 1, 1});
     }
@@ -155,139 +365,597 @@ void InteractiveMesh::UpdateExcitableVertices() {
 
 void InteractiveMesh::LoadRealImpact() {
     RealImpact = std::make_unique<::RealImpact>(FilePath.parent_path());
-    Scene.AddMesh(&RealImpactListenerPoints);
+    Scene.AddMesh(&RealImpactListenerPoints, true);
 }
 
 void InteractiveMesh::UpdateTets() {
     if (ActiveGeometryMode == GeometryMode_Tets) HoveredVertexIndex = CameraTargetVertexIndex = -1;
 
-    Tets.Clear();
+    const auto &tets = *TetGenResult;
+    std::vector<vec3> points(tets.numberofpoints);
+    for (uint i = 0; i < points.size(); ++i) {
+        points[i] = {tets.pointlist[i * 3], tets.pointlist[i * 3 + 1], tets.pointlist[i * 3 + 2]};
+    }
+    std::vector<uint> triangle_indices(tets.numberoftrifaces * 3);
+    for (uint i = 0; i < triangle_indices.size(); i += 3) {
+        // Reverse TetGen's winding order, so normals face outward.
+        triangle_indices[i] = tets.trifacelist[i + 2];
+        triangle_indices[i + 1] = tets.trifacelist[i + 1];
+        triangle_indices[i + 2] = tets.trifacelist[i];
+    }
+    Tets.SetTriangles(points, triangle_indices);
+    TetSurfaceVertexIndices = TetSurfaceVertices(tets);
+
+    UpdateExcitableVertices();
+}
+
+// Tet cache entry: A `TetCacheHeader`, followed by the tetgen output arrays used by the app:
+// points (xyz `REAL`s), tetrahedra (4 `int` indices each), and boundary triangles (3 `int` indices each).
+struct TetCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    int32_t NumPoints, NumTetrahedra, NumTriFaces, Padding;
+};
+static constexpr char TetCacheMagic[4]{'M', '2', 'T', 'C'};
+static constexpr uint32_t TetCacheVersion = 1;
+
+static std::unique_ptr<tetgenio> LoadCachedTets(const fs::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    TetCacheHeader header;
+    if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) return nullptr;
+    if (std::memcmp(header.Magic, TetCacheMagic, sizeof(TetCacheMagic)) != 0 || header.Version != TetCacheVersion) return nullptr;
+    if (header.NumPoints < 0 || header.NumTetrahedra < 0 || header.NumTriFaces < 0) return nullptr;
+    // Check the counts against the file size before allocating, so a corrupt header can't trigger huge allocations.
+    std::error_code error;
+    const auto file_size = fs::file_size(path, error);
+    const size_t expected_size = sizeof(header) + sizeof(REAL) * size_t(header.NumPoints) * 3 + sizeof(int) * (size_t(header.NumTetrahedra) * 4 + size_t(header.NumTriFaces) * 3);
+    if (error || file_size != expected_size) return nullptr;
+
+    auto tets = std::make_unique<tetgenio>();
+    tets->firstnumber = 0;
+    tets->numberofcorners = 4;
+    tets->numberofpoints = header.NumPoints;
+    tets->numberoftetrahedra = header.NumTetrahedra;
+    tets->numberoftrifaces = header.NumTriFaces;
+    tets->pointlist = new REAL[tets->numberofpoints * 3];
+    tets->tetrahedronlist = new int[tets->numberoftetrahedra * 4];
+    tets->trifacelist = new int[tets->numberoftrifaces * 3];
+    file.read(reinterpret_cast<char *>(tets->pointlist), sizeof(REAL) * tets->numberofpoints * 3);
+    file.read(reinterpret_cast<char *>(tets->tetrahedronlist), sizeof(int) * tets->numberoftetrahedra * 4);
+    file.read(reinterpret_cast<char *>(tets->trifacelist), sizeof(int) * tets->numberoftrifaces * 3);
+    if (!file) return nullptr;
+
+    // Don't let a corrupt entry index out of bounds.
+    const auto out_of_range = [&](const int *indices, size_t count) {
+        return std::any_of(indices, indices + count, [&](int index) { return index < 0 || index >= header.NumPoints; });
+    };
+    if (out_of_range(tets->tetrahedronlist, size_t(tets->numberoftetrahedra) * 4) || out_of_range(tets->trifacelist, size_t(tets->numberoftrifaces) * 3)) return nullptr;
+    return tets;
+}
 
-    Geometry::MeshType tet_mesh;
-    for (uint i = 0; i < uint(TetGenResult->numberofpoints); ++i) {
-        tet_mesh.add_vertex({TetGenResult->pointlist[i * 3], TetGenResult->pointlist[i * 3 + 1], TetGenResult->pointlist[i * 3 + 2]});
+static void SaveCachedTets(const fs::path &path, const tetgenio &tets) {
+    const auto tmp_path = Cache::TempPath(path);
+    bool written;
+    {
+        std::ofstream file(tmp_path, std::ios::binary);
+        TetCacheHeader header{.Version = TetCacheVersion, .NumPoints = tets.numberofpoints, .NumTetrahedra = tets.numberoftetrahedra, .NumTriFaces = tets.numberoftrifaces, .Padding = 0};
+        std::memcpy(header.Magic, TetCacheMagic, sizeof(TetCacheMagic));
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(tets.pointlist), sizeof(REAL) * tets.numberofpoints * 3);
+        file.write(reinterpret_cast<const char *>(tets.tetrahedronlist), sizeof(int) * tets.numberoftetrahedra * 4);
+        file.write(reinterpret_cast<const char *>(tets.trifacelist), sizeof(int) * tets.numberoftrifaces * 3);
+        file.close();
+        written = bool(file);
+        if (!written) std::cerr << "Failed to write tet cache entry " << tmp_path << '\n';
     }
+    Cache::CommitEntry(tmp_path, path, written);
+}
+
+// Decimated surface cache entry: A `SurfaceCacheHeader`, followed by the points (xyz `float`s) and triangles (3 `uint` indices each).
+struct SurfaceCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t NumPoints, NumTriangles;
+};
+static constexpr char SurfaceCacheMagic[4]{'M', '2', 'S', 'C'};
+static constexpr uint32_t SurfaceCacheVersion = 1;
+
+static bool LoadCachedSurface(const fs::path &path, std::vector<vec3> &points, std::vector<uint> &triangle_indices) {
+    std::ifstream file(path, std::ios::binary);
+    SurfaceCacheHeader header;
+    if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.Magic, SurfaceCacheMagic, sizeof(SurfaceCacheMagic)) != 0 || header.Version != SurfaceCacheVersion) return false;
+    std::error_code error;
+    const auto file_size = fs::file_size(path, error);
+    if (error || file_size != sizeof(header) + sizeof(vec3) * size_t(header.NumPoints) + sizeof(uint) * size_t(header.NumTriangles) * 3) return false;
+
+    std::vector<vec3> cached_points(header.NumPoints);
+    std::vector<uint> cached_indices(size_t(header.NumTriangles) * 3);
+    file.read(reinterpret_cast<char *>(cached_points.data()), sizeof(vec3) * cached_points.size());
+    file.read(reinterpret_cast<char *>(cached_indices.data()), sizeof(uint) * cached_indices.size());
+    if (!file) return false;
+    // Don't let a corrupt entry index out of bounds.
+    if (std::any_of(cached_indices.begin(), cached_indices.end(), [&](uint index) { return index >= header.NumPoints; })) return false;
+
+    points = std::move(cached_points);
+    triangle_indices = std::move(cached_indices);
+    return true;
+}
 
-    for (uint i = 0; i < uint(TetGenResult->numberoftrifaces); ++i) {
-        const auto &tri_indices = TetGenResult->trifacelist;
-        const uint tri_i = i * 3;
-        const uint a = tri_indices[tri_i + 2], b = tri_indices[tri_i + 1], c = tri_indices[tri_i];
-        tet_mesh.add_face(tet_mesh.vertex_handle(a), tet_mesh.vertex_handle(b), tet_mesh.vertex_handle(c));
+static void SaveCachedSurface(const fs::path &path, const std::vector<vec3> &points, const std::vector<uint> &triangle_indices) {
+    const auto tmp_path = Cache::TempPath(path);
+    bool written;
+    {
+        std::ofstream file(tmp_path, std::ios::binary);
+        SurfaceCacheHeader header{.Version = SurfaceCacheVersion, .NumPoints = uint32_t(points.size()), .NumTriangles = uint32_t(triangle_indices.size() / 3)};
+        std::memcpy(header.Magic, SurfaceCacheMagic, sizeof(SurfaceCacheMagic));
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(points.data()), sizeof(vec3) * points.size());
+        file.write(reinterpret_cast<const char *>(triangle_indices.data()), sizeof(uint) * triangle_indices.size());
+        file.close();
+        written = bool(file);
+        if (!written) std::cerr << "Failed to write decimated surface cache entry " << tmp_path << '\n';
     }
+    Cache::CommitEntry(tmp_path, path, written);
+}
 
-    Tets.SetOpenMesh(tet_mesh);
+// Tetgen input for a triangle mesh, built from contiguous arrays with a constant number of allocations,
+// rather than several allocations per triangle.
+// `tetgenio` frees everything it points to when destroyed, so its views into these arrays are detached first.
+struct TetgenTriangleInput {
+    TetgenTriangleInput(const std::vector<vec3> &points, const std::vector<uint> &triangle_indices)
+        : Indices(triangle_indices.begin(), triangle_indices.end()),
+          Polygons(triangle_indices.size() / 3), Facets(Polygons.size()) {
+        Points.reserve(points.size() * 3); // `REAL` is `double`.
+        for (const auto &p : points) Points.insert(Points.end(), {p.x, p.y, p.z});
+        for (size_t i = 0; i < Facets.size(); ++i) {
+            Polygons[i] = {.vertexlist = Indices.data() + i * 3, .numberofvertices = 3};
+            Facets[i] = {.polygonlist = &Polygons[i], .numberofpolygons = 1, .holelist = nullptr, .numberofholes = 0};
+        }
+        In.firstnumber = 0;
+        In.numberofpoints = points.size();
+        In.pointlist = Points.data();
+        In.numberoffacets = Facets.size();
+        In.facetlist = Facets.data();
+    }
+    ~TetgenTriangleInput() {
+        In.pointlist = nullptr;
+        In.numberofpoints = 0;
+        In.facetlist = nullptr;
+        In.numberoffacets = 0;
+    }
 
-    UpdateExcitableVertices();
+    std::vector<REAL> Points;
+    std::vector<int> Indices;
+    std::vector<tetgenio::polygon> Polygons;
+    std::vector<tetgenio::facet> Facets;
+    tetgenio In; // Declared last, so it's destroyed first.
+};
+
+// Linear tets need about this many elements per wavelength to resolve a mode accurately.
+static constexpr float ElementsPerWavelength = 10;
+
+// Assumes mesh coordinates are in meters.
+float InteractiveMesh::ComputeAutoMaxTetVolume() const {
+    // Shear waves are the slowest bulk waves, so they have the shortest wavelength at a given frequency.
+    const double shear_wave_speed = std::sqrt(Material.YoungModulus / (2 * Material.Density * (1 + Material.PoissonRatio)));
+    const double edge_length = shear_wave_speed / MaxModeFrequency / ElementsPerWavelength;
+    return std::pow(edge_length, 3) / (6 * std::sqrt(2.0)); // Volume of a regular tetrahedron.
 }
 
-void InteractiveMesh::GenerateTets() {
-    tetgenio in;
-    in.firstnumber = 0;
-    const float *vertices = Polyhedron.GetVertices();
-    const auto &triangle_indices = Polyhedron.GenerateTriangleIndices();
-    in.numberofpoints = Polyhedron.NumVertices();
-    in.pointlist = new REAL[in.numberofpoints * 3];
-    for (uint i = 0; i < uint(in.numberofpoints); ++i) {
-        in.pointlist[i * 3] = vertices[i * 3];
-        in.pointlist[i * 3 + 1] = vertices[i * 3 + 1];
-        in.pointlist[i * 3 + 2] = vertices[i * 3 + 2];
-    }
-
-    in.numberoffacets = triangle_indices.size() / 3;
-    in.facetlist = new tetgenio::facet[in.numberoffacets];
-
-    for (uint i = 0; i < uint(in.numberoffacets); ++i) {
-        tetgenio::facet &f = in.facetlist[i];
-        tetgenio::init(&f);
-        f.numberofpolygons = 1;
-        f.polygonlist = new tetgenio::polygon[f.numberofpolygons];
-        f.polygonlist[0].numberofvertices = 3;
-        f.polygonlist[0].vertexlist = new int[f.polygonlist[0].numberofvertices];
-        f.polygonlist[0].vertexlist[0] = triangle_indices[i * 3];
-        f.polygonlist[0].vertexlist[1] = triangle_indices[i * 3 + 1];
-        f.polygonlist[0].vertexlist[2] = triangle_indices[i * 3 + 2];
-    }
-
-    const std::string options = QualityTets ? "pq" : "p";
-    TetGenResult = std::make_unique<tetgenio>();
+std::string InteractiveMesh::TetGenOptions() const {
+    std::string options = "p";
+    if (QualityTets) options += std::format("q{:g}", MaxRadiusEdgeRatio);
+    if (const float max_volume = AutoMaxTetVolume ? ComputeAutoMaxTetVolume() : MaxTetVolume; max_volume > 0) {
+        options += std::format("a{:g}", max_volume);
+    }
+    return options;
+}
+
+// Inputs are copied from the mesh on the UI thread when the build starts, so the UI stays responsive while it runs.
+// Results start out as the installed results, and are replaced by the stages that rerun.
+struct InteractiveMesh::ModelBuild {
+    BuildKeys Keys; // Keys of the inputs.
+    BuildKeys Completed; // Keys of the stages completed by this build.
+    JobProgress Progress;
+    std::shared_ptr<const ModalModel> VoiceModel; // The voice's model when the build started.
+
+    // Tets stage inputs.
+    std::vector<vec3> SurfacePoints;
+    std::vector<uint> SurfaceTriangles;
+    std::string TetGenOptions;
+    bool RepairSurface, RequireValidSurface, Decimate, UseCache;
+    int DecimationTargetFaces;
+    float DecimationMaxError;
+    // Later stage inputs.
+    MaterialProperties Material;
+    float MaxModeFrequency;
+    int NumExcitableVertices;
+    ModalModel::ReduceSettings ModeReduction;
+
+    std::shared_ptr<const tetgenio> Tets;
+    std::optional<MeshRepair::Report> SurfaceReport;
+    uint TetSurfaceFaces = 0;
+    std::shared_ptr<const ModalModel> Modes, Gains;
+    std::unique_ptr<ModalModel> Synth;
+    ModalModel::ReduceReport ReduceReport;
+};
+
+static void DecimateSurface(std::vector<vec3> &points, std::vector<uint> &triangle_indices, uint target_faces, float max_error, bool use_cache) {
+    const uint64_t cache_key = Cache::Hasher{}
+                                   .Add(SurfaceCacheVersion)
+                                   .Add(points)
+                                   .Add(triangle_indices)
+                                   .Add(uint32_t(target_faces))
+                                   .Add(max_error)
+                                   .Hash;
+    const auto cache_path = Cache::EntryPath("decimated", cache_key, "surface");
+    if (use_cache && LoadCachedSurface(cache_path, points, triangle_indices)) return;
+
+    Decimation::Decimate(points, triangle_indices, target_faces, max_error);
+    if (use_cache) SaveCachedSurface(cache_path, points, triangle_indices);
+}
+
+void InteractiveMesh::BuildTets(ModelBuild &build, JobProgress &progress) {
+    progress.SetStage("Checking surface", 0);
+    // The acoustic model is built from the (optionally simplified) surface, while `Polyhedron` is left as-is for rendering.
+    auto &points = build.SurfacePoints;
+    auto &triangle_indices = build.SurfaceTriangles;
+
+    // Check the surface up front, since TetGen fails slowly (or produces garbage) on broken surfaces.
+    build.SurfaceReport = build.RepairSurface ? MeshRepair::Repair(points, triangle_indices) : MeshRepair::Check(points, triangle_indices);
+    if (build.RequireValidSurface && !build.SurfaceReport->IsValid()) {
+        throw std::runtime_error("Surface mesh is not valid for tetrahedralization:\n" + build.SurfaceReport->Describe());
+    }
+
+    if (build.Decimate) {
+        progress.ThrowIfCanceled();
+        progress.SetStage("Decimating surface", 0.03);
+        DecimateSurface(points, triangle_indices, build.DecimationTargetFaces, build.DecimationMaxError, build.UseCache);
+    }
+    build.TetSurfaceFaces = triangle_indices.size() / 3;
+
+    // Tetrahedralization only depends on the surface mesh and the tetgen switches.
+    const auto &options = build.TetGenOptions;
+    const uint64_t cache_key = Cache::Hasher{}
+                                   .Add(TetCacheVersion)
+                                   .Add(points)
+                                   .Add(triangle_indices)
+                                   .Add(options)
+                                   .Hash;
+    const auto cache_path = Cache::EntryPath("tets", cache_key, "tets");
+    progress.ThrowIfCanceled();
+    if (build.UseCache) {
+        progress.SetStage("Loading cached tetrahedral mesh", 0.05);
+        if (auto cached = LoadCachedTets(cache_path)) {
+            build.Tets = std::move(cached);
+            build.Completed.Tets = build.Keys.Tets;
+            return;
+        }
+    }
+
+    progress.SetStage("Tetrahedralizing", 0.05);
+    TetgenTriangleInput input{points, triangle_indices};
+    auto result = std::make_unique<tetgenio>();
     std::vector<char> options_mutable(options.begin(), options.end());
-    tetrahedralize(options_mutable.data(), &in, TetGenResult.get());
+    options_mutable.push_back('\0');
+    tetrahedralize(options_mutable.data(), &input.In, result.get());
+    progress.ThrowIfCanceled();
+    if (build.UseCache) {
+        progress.SetStage("Caching tetrahedral mesh", 0.25);
+        SaveCachedTets(cache_path, *result);
+    }
+    build.Tets = std::move(result);
+    build.Completed.Tets = build.Keys.Tets;
 }
 
-std::string InteractiveMesh::GenerateDsp() const {
-    if (!TetGenResult) return "";
+static m2f::CommonArguments ModelArguments(const std::vector<int> &excitable_vertices, float modes_max_freq = 20000) {
+    return {
+        .modelName = "modalModel",
+        .freqControl = true,
+        .modesMinFreq = 20,
+        .modesMaxFreq = modes_max_freq,
+        .targetNModes = 40, // number of synthesized modes, starting with the lowest frequency in the provided min/max range
+        .femNModes = 80, // number of modes to be computed for the finite element analysis
+        .exPos = excitable_vertices,
+        .nExPos = int(excitable_vertices.size()),
+        .debugMode = false,
+    };
+}
 
+// Computes gains at every surface vertex, so changing the excitable vertices doesn't require recomputing the modes.
+void InteractiveMesh::BuildModes(ModelBuild &build, JobProgress &progress) {
+    progress.SetStage("Building finite element mesh", 0.3);
+    const auto &tets = *build.Tets;
     std::vector<int> tet_indices;
-    tet_indices.reserve(TetGenResult->numberoftetrahedra * 4 * 3); // 4 triangles per tetrahedron, 3 indices per triangle.
+    tet_indices.reserve(tets.numberoftetrahedra * 4 * 3); // 4 triangles per tetrahedron, 3 indices per triangle.
     // Turn each tetrahedron into 4 triangles.
-    for (uint i = 0; i < uint(TetGenResult->numberoftetrahedra); ++i) {
-        auto &result_indices = TetGenResult->tetrahedronlist;
+    for (uint i = 0; i < uint(tets.numberoftetrahedra); ++i) {
+        auto &result_indices = tets.tetrahedronlist;
         uint tri_i = i * 4;
         int a = result_indices[tri_i], b = result_indices[tri_i + 1], c = result_indices[tri_i + 2], d = result_indices[tri_i + 3];
         tet_indices.insert(tet_indices.end(), {a, b, c, d, a, b, c, d, a, b, c, d});
     }
     // Convert the tetrahedral mesh into a VegaFEM Tets.
+    const auto &material = build.Material;
     TetMesh volumetric_mesh{
-        TetGenResult->numberofpoints, TetGenResult->pointlist, TetGenResult->numberoftetrahedra * 3, tet_indices.data(),
-        Material.YoungModulus, Material.PoissonRatio, Material.Density
+        tets.numberofpoints, tets.pointlist, tets.numberoftetrahedra * 3, tet_indices.data(),
+        material.YoungModulus, material.PoissonRatio, material.Density
     };
 
-    const auto m2f_result = m2f::mesh2faust(
+    progress.ThrowIfCanceled();
+    // mesh2faust assembles the mass & stiffness matrices and solves the eigenproblem in one call.
+    progress.SetStage("Assembling matrices and solving for modes", 0.35);
+    std::vector<int> surface_vertices = TetSurfaceVertices(tets);
+    const auto m2f_model = m2f::mesh2modal(
         &volumetric_mesh,
         m2f::MaterialProperties{
-            .youngModulus = Material.YoungModulus,
-            .poissonRatio = Material.PoissonRatio,
-            .density = Material.Density,
-            .alpha = Material.Alpha,
-            .beta = Material.Beta
+            .youngModulus = material.YoungModulus,
+            .poissonRatio = material.PoissonRatio,
+            .density = material.Density,
+            .alpha = material.Alpha,
+            .beta = material.Beta
         },
-        m2f::CommonArguments{
-            .modelName = "modalModel",
-            .freqControl = true,
-            .modesMinFreq = 20,
-            .modesMaxFreq = 20000,
-            .targetNModes = 40, // number of synthesized modes, starting with the lowest frequency in the provided min/max range
-            .femNModes = 80, // number of modes to be computed for the finite element analysis
-            .exPos = ExcitableVertexIndices,
-            .nExPos = int(ExcitableVertexIndices.size()),
-            .debugMode = false,
-        }
+        ModelArguments(surface_vertices, build.MaxModeFrequency)
     );
-    return m2f_result.modelDsp;
+    progress.ThrowIfCanceled();
+
+    ModalModel::Data data{
+        .Frequencies = m2f_model.modeFreqs,
+        .T60s = m2f_model.modeT60s,
+        .ExcitableVertices = std::move(surface_vertices),
+    };
+    data.Gains.reserve(m2f_model.modeGains.size() * data.Frequencies.size());
+    for (const auto &excite_pos_gains : m2f_model.modeGains) data.Gains.insert(data.Gains.end(), excite_pos_gains.begin(), excite_pos_gains.end());
+
+    // Keep the mesh the model was computed from, so saved models are self-contained.
+    data.TetVertices.assign(tets.pointlist, tets.pointlist + tets.numberofpoints * 3);
+    data.Tetrahedra.assign(tets.tetrahedronlist, tets.tetrahedronlist + tets.numberoftetrahedra * 4);
+    data.SurfaceTriangles.assign(tets.trifacelist, tets.trifacelist + tets.numberoftrifaces * 3);
+    build.Modes = std::make_shared<const ModalModel>(std::move(data), material);
+    build.Completed.Modes = build.Keys.Modes;
 }
 
-static constexpr float VertexHoverRadius = 5.f;
-static constexpr float VertexHoverRadiusSquared = VertexHoverRadius * VertexHoverRadius;
+void InteractiveMesh::BuildGains(ModelBuild &build, JobProgress &progress) {
+    progress.SetStage("Selecting excitation positions", 0.9);
+    const auto &modes = *build.Modes; // Excitation positions are all surface vertices.
+    const uint num_modes = modes.NumModes();
+    ModalModel::Data data{
+        .Frequencies = {modes.Frequencies.begin(), modes.Frequencies.end()},
+        .T60s = {modes.T60s.begin(), modes.T60s.end()},
+        .TetVertices = {modes.TetVertices.begin(), modes.TetVertices.end()},
+        .Tetrahedra = {modes.Tetrahedra.begin(), modes.Tetrahedra.end()},
+        .SurfaceTriangles = {modes.SurfaceTriangles.begin(), modes.SurfaceTriangles.end()},
+    };
+    const auto excite_positions = SampleExcitationCandidates(build.NumExcitableVertices, modes.NumExcitePositions());
+    data.ExcitableVertices.reserve(excite_positions.size());
+    data.Gains.reserve(excite_positions.size() * num_modes);
+    for (const uint excite_pos : excite_positions) {
+        data.ExcitableVertices.push_back(modes.ExcitableVertices[excite_pos]);
+        const auto gains = modes.Gains.subspan(excite_pos * num_modes, num_modes);
+        data.Gains.insert(data.Gains.end(), gains.begin(), gains.end());
+    }
+    build.Gains = std::make_shared<const ModalModel>(std::move(data), modes.Material);
+    build.Completed.Gains = build.Keys.Gains;
+}
 
-using namespace ImGui;
+void InteractiveMesh::BuildSynth(ModelBuild &build, JobProgress &progress) {
+    progress.SetStage("Reducing modes", 0.95);
+    build.Synth = std::make_unique<ModalModel>(*build.Gains); // Shares the data.
+    build.ReduceReport = build.Synth->Reduce(build.ModeReduction);
+    // The Faust instrument is only generated if it's selected (see `UpdateFaustDsp`).
+    build.Completed.Synth = build.Keys.Synth;
+}
 
-void InteractiveMesh::UpdateHoveredVertex() {
-    // Find the hovered vertex, favoring the one nearest to the camera if multiple are hovered.
-    HoveredVertexIndex = -1;
-    if (IsWindowHovered()) {
-        const vec3 camera_position = glm::inverse(Scene.CameraView)[3];
-        const auto content_region = GetContentRegionAvail();
-        const auto &io = ImGui::GetIO();
-        // Transform each vertex position to screen space and check if the mouse is hovering over it.
-        const auto &mouse_pos = io.MousePos;
-        const auto &content_pos = GetWindowPos() + GetWindowContentRegionMin();
-        const auto &view_projection = Scene.CameraProjection * Scene.CameraView;
-        float min_vertex_camera_distance = FLT_MAX;
-        for (size_t i = 0; i < NumVertices(); i++) {
-            const auto &v = vec4{GetVertex(i), 1};
-            const vec4 pos_clip_space = view_projection * v;
-            const vec4 tmp = (pos_clip_space / pos_clip_space.w) * 0.5f + 0.5f;
-            const auto vertex_screen = ImVec2{tmp.x, 1.0f - tmp.y} * content_region + content_pos;
-            const float screen_dist_squared = pow(mouse_pos.x - vertex_screen.x, 2) + pow(mouse_pos.y - vertex_screen.y, 2);
-            if (screen_dist_squared <= VertexHoverRadiusSquared) {
-                const float vertex_camera_distance = glm::distance(camera_position, glm::vec3{v});
-                if (vertex_camera_distance < min_vertex_camera_distance) {
-                    min_vertex_camera_distance = vertex_camera_distance;
-                    HoveredVertexIndex = i;
-                }
-            }
+InteractiveMesh::BuildKeys InteractiveMesh::ComputeBuildKeys() {
+    if (SurfaceChanged) {
+        SurfaceKey = Cache::Hasher{}
+                         .Add(std::span<const float>{Polyhedron.GetVertices(), Polyhedron.NumVertices() * 3})
+                         .Add(Polyhedron.GetTriangleIndices())
+                         .Hash;
+        SurfaceChanged = false;
+    }
+
+    BuildKeys keys;
+    // Material only affects the tets through the automatic max volume, which is part of the options.
+    keys.Tets = Cache::Hasher{}
+                    .Add(SurfaceKey)
+                    .Add(TetGenOptions())
+                    .Add(RepairSurface)
+                    .Add(RequireValidSurface)
+                    .Add(Decimate)
+                    .Add(DecimationTargetFaces)
+                    .Add(DecimationMaxError)
+                    .Hash;
+    keys.Modes = Cache::Hasher{}
+                     .Add(keys.Tets)
+                     .Add(std::span<const MaterialProperties>{&Material, 1})
+                     .Add(MaxModeFrequency)
+                     .Hash;
+    keys.Gains = Cache::Hasher{}.Add(keys.Modes).Add(NumExcitableVertices).Hash;
+    keys.Synth = Cache::Hasher{}
+                     .Add(keys.Gains)
+                     .Add(ModeReduction.Enabled)
+                     .Add(ModeReduction.MergeBarks)
+                     .Add(ModeReduction.MaskingThresholdDb)
+                     .Hash;
+    return keys;
+}
+
+bool InteractiveMesh::CanBuildModel() const { return !MeshProfile::ClosePath; }
+
+void InteractiveMesh::BuildModel(ModelStage target) {
+    if (BuildTask || !CanBuildModel()) return;
+
+    const auto keys = ComputeBuildKeys();
+    const bool tets_stale = !TetGenResult || !HasTets() || keys.Tets != BuiltKeys.Tets;
+    const bool modes_stale = target >= ModelStage_Modes && (tets_stale || !ModesModel || keys.Modes != BuiltKeys.Modes);
+    const bool gains_stale = target >= ModelStage_Gains && (modes_stale || !GainsModel || keys.Gains != BuiltKeys.Gains);
+    const bool synth_stale = target >= ModelStage_Synth && (gains_stale || keys.Synth != BuiltKeys.Synth);
+    if (!tets_stale && !modes_stale && !gains_stale && !synth_stale) return;
+
+    auto build = std::make_shared<ModelBuild>();
+    build->Keys = keys;
+    build->VoiceModel = Audio::FaustState::GetModel(VoiceId);
+    if (tets_stale) {
+        const auto *vertices = reinterpret_cast<const vec3 *>(Polyhedron.GetVertices());
+        build->SurfacePoints.assign(vertices, vertices + Polyhedron.NumVertices());
+        build->SurfaceTriangles = Polyhedron.GetTriangleIndices();
+        build->TetGenOptions = TetGenOptions();
+        build->RepairSurface = RepairSurface;
+        build->RequireValidSurface = RequireValidSurface;
+        build->Decimate = Decimate;
+        build->UseCache = UseCache;
+        build->DecimationTargetFaces = DecimationTargetFaces;
+        build->DecimationMaxError = DecimationMaxError;
+    }
+    build->Material = Material;
+    build->MaxModeFrequency = MaxModeFrequency;
+    build->NumExcitableVertices = NumExcitableVertices;
+    build->ModeReduction = ModeReduction;
+    build->Tets = TetGenResult;
+    build->Modes = ModesModel;
+    build->Gains = GainsModel;
+
+    // Chain the stale stages. If a stage fails or is canceled, the ones after it are skipped.
+    BuildError.clear();
+    Scheduler::TaskHandle task;
+    const auto submit = [&](void (*stage)(ModelBuild &, JobProgress &)) {
+        task = Scheduler::Submit(
+            [build, stage] {
+                build->Progress.ThrowIfCanceled();
+                stage(*build, build->Progress);
+            },
+            Scheduler::Priority::Normal, {task}
+        );
+    };
+    if (tets_stale) submit(BuildTets);
+    if (modes_stale) submit(BuildModes);
+    if (gains_stale) submit(BuildGains);
+    if (synth_stale) submit(BuildSynth);
+    Build = std::move(build);
+    BuildTask = std::move(task);
+}
+
+void InteractiveMesh::UpdateModelBuild() {
+    UpdateFaustDsp();
+    if (BuildTask) {
+        if (!Scheduler::IsDone(BuildTask)) {
+            // Restart with the latest inputs, rather than finishing a build that's already outdated.
+            if (AutoBuildModel && !Build->Progress.IsCancelRequested() && ComputeBuildKeys().Synth != Build->Keys.Synth) Build->Progress.RequestCancel();
+            return;
         }
+        InstallModelBuild();
+    }
+    if (AutoBuildModel && CanBuildModel()) {
+        if (const auto keys = ComputeBuildKeys(); keys.Synth != BuiltKeys.Synth && keys.Synth != FailedKeys.Synth) BuildModel(ModelStage_Synth);
     }
+}
+
+void InteractiveMesh::UpdateFaustDsp() {
+    if (FaustDspTask) {
+        if (!Scheduler::IsDone(FaustDspTask)) return;
+
+        try {
+            Scheduler::Wait(FaustDspTask);
+            // The voice compiles it on the next audio update. Skip it if the model has changed since.
+            if (Audio::FaustState::GetModel(VoiceId) == FaustDspModel) Audio::FaustState::SetCode(VoiceId, std::move(*FaustDsp));
+        } catch (const std::exception &e) {
+            std::cerr << "Failed to generate Faust DSP: " << e.what() << '\n';
+        }
+        FaustDspTask.reset();
+        FaustDsp.reset();
+    }
+
+    const auto model = Audio::FaustState::GetModel(VoiceId);
+    if (model == FaustDspModel) return;
+    if (FaustDspModel) {
+        // Don't keep an instrument for an outdated model around.
+        Audio::FaustState::SetCode(VoiceId, "");
+        FaustDspModel.reset();
+    }
+    if (!model || Audio::FaustState::UsesNativeSynth(VoiceId)) return;
+
+    FaustDspModel = model;
+    FaustDsp = std::make_shared<std::string>();
+    FaustDspTask = Scheduler::Submit([model, dsp = FaustDsp] {
+        *dsp = Audio::FaustState::GenerateModelInstrumentDsp(GenerateDsp(*model), model->NumExcitePositions());
+    });
+}
+
+void InteractiveMesh::InstallModelBuild() {
+    const auto build = std::move(Build);
+    const auto task = std::move(BuildTask);
+    try {
+        Scheduler::Wait(task);
+        FailedKeys = {};
+    } catch (const JobCanceled &) {
+    } catch (const std::exception &e) {
+        BuildError = e.what();
+        FailedKeys = build->Keys;
+    }
+
+    // Install the stages that completed, even if a later one failed.
+    if (build->SurfaceReport) SurfaceReport = std::move(build->SurfaceReport);
+    const auto &completed = build->Completed;
+    if (completed.Tets) {
+        TetGenResult = std::move(build->Tets);
+        TetSurfaceFaces = build->TetSurfaceFaces;
+        BuiltKeys.Tets = completed.Tets;
+        UpdateTets();
+        SetGeometryMode(GeometryMode_Tets); // Automatically switch to tetrahedral view.
+    }
+    if (completed.Modes) {
+        ModesModel = std::move(build->Modes);
+        BuiltKeys.Modes = completed.Modes;
+    }
+    if (completed.Gains) {
+        GainsModel = std::move(build->Gains);
+        BuiltKeys.Gains = completed.Gains;
+    }
+    // Don't replace a model installed while the build ran (e.g. loaded from a file).
+    if (completed.Synth && Audio::FaustState::GetModel(VoiceId) == build->VoiceModel) {
+        Audio::FaustState::SetModel(VoiceId, std::move(build->Synth));
+        if (LoadedModel) {
+            LoadedModel.reset();
+            UpdateExcitableVertices();
+        }
+        ModeReductionReport = build->ReduceReport;
+        BuiltKeys.Synth = completed.Synth;
+    }
+}
+
+void InteractiveMesh::LoadModel(const fs::path &file_path) {
+    std::shared_ptr<const ModalModel> model = ModalModel::Load(file_path);
+    Audio::FaustState::SetModel(VoiceId, model); // Its Faust instrument is generated by `UpdateFaustDsp` if selected.
+    ModeReductionReport.reset();
+    // The installed synth stage no longer matches the voice, so the next build reinstalls it.
+    // Only build on request though, rather than silently replacing the loaded model on the next input change.
+    BuiltKeys.Synth = 0;
+    AutoBuildModel = false;
+    LoadedModel = std::move(model);
+    UpdateExcitableVertices();
+}
+
+std::string InteractiveMesh::GenerateDsp(const ModalModel &model) {
+    m2f::ModalModel m2f_model{
+        .modeFreqs = {model.Frequencies.begin(), model.Frequencies.end()},
+        .modeT60s = {model.T60s.begin(), model.T60s.end()},
+    };
+    m2f_model.modeGains.reserve(model.NumExcitePositions());
+    for (uint excite_pos = 0; excite_pos < model.NumExcitePositions(); excite_pos++) {
+        const auto gains = model.Gains.subspan(excite_pos * model.NumModes(), model.NumModes());
+        m2f_model.modeGains.emplace_back(gains.begin(), gains.end());
+    }
+    return m2f::modal2faust(m2f_model, ModelArguments({model.ExcitableVertices.begin(), model.ExcitableVertices.end()}));
+}
+
+using namespace ImGui;
+
+void InteractiveMesh::UpdateHoveredVertex() {
+    // The scene picks the hovered vertex on the GPU, favoring the one nearest to the camera if multiple are hovered.
+    // The pick is from the previous frame, so it may be out of range right after switching geometry.
+    HoveredVertexIndex = Scene.PickMesh == this && Scene.PickedVertex < int(NumVertices()) ? Scene.PickedVertex : -1;
 
     HoveredVertexArrow.ClearInstances();
     if (HoveredVertexIndex >= 0 && HoveredVertexIndex < int(NumVertices())) {
@@ -308,30 +976,13 @@ void InteractiveMesh::PrepareRender(RenderMode mode) {
 }
 
 void InteractiveMesh::TriggerVertex(uint vertex_index, float amount) {
-    if (ExcitableVertexIndices.empty() || !Audio::FaustState::IsRunning()) return;
-
-    const auto &vertex = GetLocalVertex(vertex_index);
-    int nearest_excite_vertex_pos = -1;
-    float min_dist = FLT_MAX;
-    for (size_t i = 0; i < ExcitableVertexIndices.size(); i++) {
-        const auto &excite_vertex_index = ExcitableVertexIndices[i];
-        const auto &excite_vertex = GetLocalVertex(excite_vertex_index);
-        const float dist = glm::distance(excite_vertex, vertex);
-        if (dist < min_dist) {
-            min_dist = dist;
-            nearest_excite_vertex_pos = i;
-        }
-    }
-    if (nearest_excite_vertex_pos >= 0) { // Shouldn't ever be false, but sanity check.
-        *Audio::FaustState::ExcitePos = nearest_excite_vertex_pos;
-        *Audio::FaustState::ExciteValue = amount;
-    }
-}
+    if (!ExcitableVertexTree || ExcitableVertexTree->Empty() || !Audio::FaustState::IsRunning(VoiceId)) return;
 
-void InteractiveMesh::ReleaseTrigger() {
-    if (Audio::FaustState::IsRunning()) *Audio::FaustState::ExciteValue = 0.f;
+    Audio::FaustState::Excite(VoiceId, ExcitableVertexTree->FindNearest(GetLocalVertex(vertex_index)), amount);
 }
 
+void InteractiveMesh::ReleaseTrigger() { Audio::FaustState::Release(VoiceId); }
+
 void InteractiveMesh::PostRender(RenderMode) {
     // Handle mouse interactions.
     const bool mouse_clicked = IsMouseClicked(0), mouse_released = IsMouseReleased(0);
@@ -366,6 +1017,20 @@ void InteractiveMesh::PostRender(RenderMode) {
     }
 }
 
+void InteractiveMesh::RenderModelBuild(ModelStage stage, const char *build_label) {
+    if (BuildTask) {
+        auto &progress = Build->Progress;
+        const auto [stage_name, fraction] = progress.Get();
+        Text("Building: %s", stage_name.c_str());
+        if (fraction >= 0) ProgressBar(fraction, {-FLT_MIN, 0});
+        if (progress.IsCancelRequested()) TextUnformatted("Canceling after the current stage...");
+        else if (Button("Cancel")) progress.RequestCancel();
+    } else if (Button(build_label)) {
+        BuildModel(stage);
+    }
+    if (!BuildError.empty()) TextColored({1, 0.4, 0.4, 1}, "%s", BuildError.c_str());
+}
+
 void InteractiveMesh::RenderConfig() {
     if (BeginTabBar("MeshConfigTabBar")) {
         if (BeginTabItem("Mesh")) {
@@ -385,10 +1050,10 @@ void InteractiveMesh::RenderConfig() {
                 const bool can_generate_tet_mesh = !MeshProfile::ClosePath;
                 if (HasTets()) {
                     Checkbox("Show excitable vertices", &ShowExcitableVertices);
-                    if (SliderInt("Num. excitable vertices", &NumExcitableVertices, 1, std::min(200, int(Tets.NumVertices())))) {
+                    if (SliderInt("Num. excitable vertices", &NumExcitableVertices, 1, std::min(200, int(TetSurfaceVertexIndices.size())))) {
                         UpdateExcitableVertices();
                     }
-                    Text("Current tetrahedral mesh:\n\tVertices: %u", Tets.NumVertices());
+                    Text("Current tetrahedral mesh:\n\tVertices: %u\n\tTetrahedra: %d", Tets.NumVertices(), TetGenResult ? TetGenResult->numberoftetrahedra : 0);
                 } else {
                     if (!can_generate_tet_mesh) {
                         BeginDisabled();
@@ -396,7 +1061,37 @@ void InteractiveMesh::RenderConfig() {
                     }
                 }
                 Checkbox("Quality mode", &QualityTets);
-                TetGenerator.RenderLauncher(HasTets() ? "Regenerate tetrahedral mesh" : "Generate tetrahedral mesh");
+                SameLine();
+                Checkbox("Use cache", &UseCache);
+                if (IsItemHovered()) SetTooltip("Applies to all meshes, including the geometry of the next loaded file.");
+                if (QualityTets) SliderFloat("Max radius-edge ratio", &MaxRadiusEdgeRatio, 1.2, 4, "%.2f");
+                SliderFloat("Max mode frequency (Hz)", &MaxModeFrequency, 100, 20000, "%.0f", ImGuiSliderFlags_Logarithmic);
+                Checkbox("Automatic max tet volume", &AutoMaxTetVolume);
+                if (AutoMaxTetVolume) {
+                    Text("Max tet volume: %g (%g elements per shortest wavelength)", ComputeAutoMaxTetVolume(), ElementsPerWavelength);
+                } else {
+                    InputFloat("Max tet volume", &MaxTetVolume, 0, 0, "%g");
+                    if (IsItemHovered()) SetTooltip("Zero means unconstrained.");
+                }
+                Checkbox("Decimate surface", &Decimate);
+                if (IsItemHovered()) SetTooltip("Simplify the surface mesh before tetrahedralization.\nThe original surface is still used for rendering.");
+                if (Decimate) {
+                    SliderInt("Target faces", &DecimationTargetFaces, 100, 100'000, "%d", ImGuiSliderFlags_Logarithmic);
+                    InputFloat("Max quadric error", &DecimationMaxError, 0, 0, "%g");
+                    if (IsItemHovered()) SetTooltip("Zero means unbounded.");
+                }
+                if (HasTets()) Text("Tet mesh surface faces: %u (original: %u)", TetSurfaceFaces, Polyhedron.NumFaces());
+                Checkbox("Repair surface", &RepairSurface);
+                if (IsItemHovered()) SetTooltip("Weld coincident vertices, and remove degenerate and duplicate faces before tetrahedralization.");
+                SameLine();
+                Checkbox("Require valid surface", &RequireValidSurface);
+                if (IsItemHovered()) SetTooltip("Don't attempt tetrahedralization if the surface is open, non-manifold or self-intersecting.");
+                if (SurfaceReport && TreeNode("Surface check")) {
+                    TextUnformatted(SurfaceReport->Describe().c_str());
+                    TreePop();
+                }
+                Text("TetGen switches: %s", TetGenOptions().c_str());
+                RenderModelBuild(ModelStage_Tets, HasTets() ? "Regenerate tetrahedral mesh" : "Generate tetrahedral mesh");
                 if (!can_generate_tet_mesh) EndDisabled();
             } else if (ActiveGeometryMode == GeometryMode_ConvexHull) {
                 if (HasConvexHull()) {
@@ -406,14 +1101,6 @@ void InteractiveMesh::RenderConfig() {
                     SetGeometryMode(GeometryMode_ConvexHull);
                 }
             }
-            const auto &center = GetMainViewport()->GetCenter();
-            SetNextWindowPos(center, ImGuiCond_Appearing, {0.5f, 0.5f});
-            SetNextWindowSize(GetMainViewport()->Size / 4);
-            if (TetGenerator.Render()) {
-                // Tet generation completed.
-                UpdateTets();
-                SetGeometryMode(GeometryMode_Tets); // Automatically switch to tetrahedral view.
-            }
             SeparatorText("Transform");
             if (Checkbox("Gizmo##Transform", &Scene.ShowGizmo)) {
                 if (Scene.ShowGizmo) {
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <optional>
+
 #include "Geometry/Arrow.h"
+#include "Geometry/MeshRepair.h"
 #include "Geometry/Primitive/Sphere.h"
 #include "Material.h"
 #include "Mesh.h"
 #include "MeshProfile.h"
+#include "ModalModel.h"
 #include "Scene.h"
 #include "Worker.h"
 
@@ -52,15 +56,65 @@ struct InteractiveMesh : Mesh {
     bool HasTets() const { return !Tets.Empty(); }
     bool HasConvexHull() const { return !ConvexHull.Empty(); }
 
-    std::string GenerateDsp() const;
+    // Stages of the model build pipeline, each depending on the one before.
+    // (The surface itself is generated on the UI thread, when loading a mesh or extruding a profile.)
+    enum ModelStage {
+        ModelStage_Tets, // Tetrahedral mesh, from the (repaired, optionally decimated) surface.
+        ModelStage_Modes, // FEM matrix assembly & eigensolve: Mode frequencies, T60s, and gains at every surface vertex.
+        ModelStage_Gains, // Mode gains at the excitable vertices.
+        ModelStage_Synth, // Perceptually reduced model, installed in the voice.
+    };
+
+    // Build the model up to and including `stage` in the background. Does nothing if a build is already running.
+    // Every stage is keyed by a content hash of its inputs and the key of the stage before it,
+    // and only stages whose key changed since they were last built are recomputed.
+    void BuildModel(ModelStage = ModelStage_Synth);
+    // Call once per frame. Installs completed builds, and with `AutoBuildModel`, starts a build whenever an input changes,
+    // canceling any build with outdated inputs.
+    // Also keeps the voice's Faust instrument in sync with its model (see `UpdateFaustDsp`).
+    void UpdateModelBuild();
+    // Build button (or progress & cancel button, while building), and the last build error.
+    void RenderModelBuild(ModelStage, const char *build_label);
+
+    // Play a modal model file in place of the built model.
+    // Its excitable vertices replace the sampled ones until a build replaces it, and automatic builds are turned off.
+    // Throws `std::runtime_error` if the file isn't a valid model file.
+    void LoadModel(const fs::path &);
+
+    static std::string GenerateDsp(const ModalModel &); // Faust code for the model, in the form expected by `GenerateModelInstrumentDsp`.
+    uint GetVoiceId() const { return VoiceId; }
 
     void ApplyTransform();
     glm::mat4 GetTransform() const;
+    void SetTranslation(const glm::vec3 &);
+
+    // Make this the scene's mesh for vertex hovering and mouse excitation (`Scene::PickMesh`).
+    // Detaches the transform gizmo from the previously selected mesh.
+    void Select();
 
     int NumExcitableVertices = 10;
     bool ShowExcitableVertices = true; // Only shown when viewing tet mesh.
-    bool QualityTets = true;
+    bool QualityTets = true; // Refine to bound the tets' radius-edge ratio (tetgen `q` switch).
+    float MaxRadiusEdgeRatio = 2; // Only used in quality mode.
+    float MaxTetVolume = 0; // Tetgen `a` switch. Zero means unconstrained.
+    // Derive `MaxTetVolume` from the shortest (shear) wavelength at `MaxModeFrequency` in the current material,
+    // for the coarsest mesh that resolves every mode up to that frequency.
+    bool AutoMaxTetVolume = false;
+    float MaxModeFrequency = 20000; // Highest mode frequency (Hz) to resolve, and to include in the modal model.
+    // Simplify the surface with quadric-error decimation before tetrahedralization, down to `DecimationTargetFaces`,
+    // or until a collapse would exceed `DecimationMaxError` (zero means unbounded).
+    bool Decimate = false;
+    int DecimationTargetFaces = 5000;
+    float DecimationMaxError = 0;
+    bool RepairSurface = true; // Weld vertices and remove degenerate/duplicate faces of the surface before tetrahedralization.
+    bool RequireValidSurface = true; // Fail tet generation up front if the surface isn't closed, manifold and free of self-intersections.
+    // Reuse processed geometry, tet meshes and decimated surfaces previously generated from the same inputs.
+    // App-wide, since the geometry cache is read when a mesh is loaded, before its own settings can be changed.
+    inline static bool UseCache = true;
     bool AutomaticTetGeneration = true;
+    bool AutoBuildModel = false; // Rebuild stale model stages in the background whenever an input changes.
+    ModalModel::ReduceSettings ModeReduction; // Copied into each build when it starts, so it can be edited while one runs.
+    std::optional<ModalModel::ReduceReport> ModeReductionReport; // For the model in the voice, if it was built here. Only set on the UI thread.
 
     fs::path FilePath; // Most recently loaded file path.
 
@@ -71,7 +125,26 @@ private:
     void UpdateExcitableVertices();
     void UpdateExcitableVertexColors();
 
-    void GenerateTets(); // Populates `TetGenResult`.
+    struct BuildKeys {
+        uint64_t Tets = 0, Modes = 0, Gains = 0, Synth = 0;
+    };
+    struct ModelBuild; // State shared by the stage tasks of a build.
+
+    BuildKeys ComputeBuildKeys();
+    bool CanBuildModel() const;
+    void InstallModelBuild(); // Install the results of the completed stages of the finished build.
+    // Generate the Faust instrument for the voice's model in the background, only once the Faust engine is selected,
+    // and drop it when the model changes. Most models are only ever played by the native synth.
+    void UpdateFaustDsp();
+
+    // Build stages. These only access the build state, so they can run on any thread.
+    static void BuildTets(ModelBuild &, JobProgress &);
+    static void BuildModes(ModelBuild &, JobProgress &);
+    static void BuildGains(ModelBuild &, JobProgress &);
+    static void BuildSynth(ModelBuild &, JobProgress &);
+
+    std::string TetGenOptions() const;
+    float ComputeAutoMaxTetVolume() const;
     void UpdateTets(); // Update the `Tets` geometry from `TetGenResult`.
 
     // Generate an axisymmetric 3D mesh by rotating the current 2D profile about the y-axis.
@@ -80,6 +153,7 @@ private:
     void LoadRealImpact(); // Load [RealImpact](https://github.com/khiner/RealImpact) in the same directory as the loaded .obj file.
 
     Scene &Scene;
+    const uint VoiceId; // Audio voice playing this mesh's model.
 
     GLGeometry Tets, ConvexHull;
 
@@ -91,17 +165,41 @@ private:
 
     GeometryMode ActiveGeometryMode = GeometryMode_Poly;
 
-    std::unique_ptr<tetgenio> TetGenResult;
+    // Installed build results, only read and written on the UI thread.
+    // Builds start from copies of these (in `ModelBuild`), and their results are only published here by `InstallModelBuild`,
+    // so the UI can read them (e.g. the tet count) while a build replaces them.
+    std::shared_ptr<const tetgenio> TetGenResult;
+    std::optional<MeshRepair::Report> SurfaceReport;
+    uint TetSurfaceFaces = 0; // Number of triangles in the surface the tets were generated from.
+    std::vector<int> TetSurfaceVertexIndices; // `TetGenResult` boundary vertices, ascending. The excitation candidates.
+    std::shared_ptr<const ModalModel> ModesModel; // Gains at every surface vertex.
+    std::shared_ptr<const ModalModel> GainsModel; // Gains at the excitable vertices.
+    BuildKeys BuiltKeys; // Keys of the installed results.
+    std::shared_ptr<const ModalModel> LoadedModel; // Model loaded from a file and installed in the voice, if it hasn't been replaced since.
+
+    fs::path GeometryCacheEntry; // Processed geometry cache entry for the loaded file. Empty if the polyhedron was modified since.
+
+    uint64_t SurfaceKey = 0;
+    bool SurfaceChanged = true; // `SurfaceKey` needs to be recomputed.
+
+    std::shared_ptr<ModelBuild> Build; // The running build. Shared with its stage tasks, so it outlives the mesh if needed.
+    Scheduler::TaskHandle BuildTask; // The last stage task of the running build.
+    BuildKeys FailedKeys; // Keys of the last failed build, so automatic builds don't retry the same inputs.
+    std::string BuildError; // Empty if the last build succeeded.
+
+    std::shared_ptr<const ModalModel> FaustDspModel; // Model of the requested (or installed) Faust code.
+    Scheduler::TaskHandle FaustDspTask; // Generates `FaustDsp`.
+    std::shared_ptr<std::string> FaustDsp;
     std::unique_ptr<MeshProfile> Profile;
     std::unique_ptr<::RealImpact> RealImpact;
 
-    Worker TetGenerator{"Generate tet mesh", "Generating tetrahedral mesh...", [&] { GenerateTets(); }};
     Worker RealImpactLoader{"Load RealImpact", "Loading RealImpact data...", [&] { LoadRealImpact(); }};
 
     int HoveredVertexIndex = -1, CameraTargetVertexIndex = -1;
     Mesh HoveredVertexArrow{Arrow{0.5, 0.1, 0.2, 0.3}, this};
 
-    std::vector<int> ExcitableVertexIndices; // Indexes into `Tets` vertices.
+    std::vector<int> ExcitableVertexIndices; // Indexes into `Tets` vertices, or `LoadedModel` tet vertices.
+    std::optional<KdTree> ExcitableVertexTree; // Over the positions of `ExcitableVertexIndices`, for `TriggerVertex`.
     Mesh ExcitableVertexArrows{Arrow{0.25, 0.05, 0.1, 0.15}, this}; // Instanced arrows for each excitable vertex, with less emphasis than `HoveredVertexArrow`.
     Mesh RealImpactListenerPoints{Sphere{0.01}}; // Instanced spheres for each listener point.
 };
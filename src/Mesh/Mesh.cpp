@@ -1,5 +1,7 @@
 #include "Mesh.h"
 
+#include <algorithm>
+
 void Mesh::Generate() {
     VertexArray.Generate();
     ColorBuffer.Generate();
@@ -40,17 +42,25 @@ void Mesh::BindData(RenderMode render_mode) const {
     VertexArray.Bind();
     GetGeometry().BindData(render_mode);
 
-    if (Dirty) {
-        if (Parent) {
-            AbsoluteTransforms = Transforms;
-            for (auto &transform : AbsoluteTransforms) transform = Parent->GetTransform() * transform;
-            TransformBuffer.SetData(AbsoluteTransforms);
-        } else {
-            TransformBuffer.SetData(Transforms);
+    if (Parent) {
+        // All absolute transforms change with the parent's transform.
+        if (Parent->GetTransform() != BoundParentTransform) {
+            BoundParentTransform = Parent->GetTransform();
+            DirtyTransforms.AddAll();
+        }
+        if (AbsoluteTransforms.size() != Transforms.size()) {
+            AbsoluteTransforms.resize(Transforms.size());
+            DirtyTransforms.AddAll();
+        }
+        if (!DirtyTransforms.Empty()) {
+            const uint end = std::min(DirtyTransforms.End, uint(Transforms.size()));
+            for (uint i = DirtyTransforms.Begin; i < end; i++) AbsoluteTransforms[i] = BoundParentTransform * Transforms[i];
+            TransformBuffer.Update(AbsoluteTransforms, DirtyTransforms);
         }
-        ColorBuffer.SetData(Colors);
+    } else if (!DirtyTransforms.Empty()) {
+        TransformBuffer.Update(Transforms, DirtyTransforms);
     }
-    Dirty = false;
+    if (!DirtyColors.Empty()) ColorBuffer.Update(Colors, DirtyColors);
 
     VertexArray.Unbind();
 }
@@ -61,9 +71,7 @@ void Mesh::Render(RenderMode mode) const {
     BindData(mode); // Only rebinds the data if it has changed.
     VertexArray.Bind();
 
-    GLenum polygon_mode = mode == RenderMode::Points ? GL_POINT : GL_FILL;
     GLenum primitive_type = mode == RenderMode::Lines ? GL_LINES : GL_TRIANGLES;
-    glPolygonMode(GL_FRONT_AND_BACK, polygon_mode);
 
     uint num_indices = GetGeometry().NumIndices();
     if (Transforms.size() == 1) {
@@ -2,15 +2,6 @@
 
 #include "Geometry/GLGeometry.h"
 
-struct GLVertexArray {
-    void Generate() { glGenVertexArrays(1, &Id); }
-    void Delete() const { glDeleteVertexArrays(1, &Id); }
-    void Bind() const { glBindVertexArray(Id); }
-    void Unbind() const { glBindVertexArray(0); }
-
-    uint Id = 0;
-};
-
 struct Mesh {
     Mesh() {}
     // If `parent` is provided, the mesh will be rendered relative to the parent's transform.
@@ -25,6 +16,7 @@ struct Mesh {
     uint NumFaces() const { return GetGeometry().NumFaces(); }
     const GLGeometry &GetPolyhedron() const { return Polyhedron; }
     const glm::mat4 &GetTransform() const { return Transforms[0]; }
+    glm::mat4 GetWorldTransform(uint instance = 0) const { return Parent ? Parent->GetTransform() * Transforms[instance] : Transforms[instance]; }
     const glm::vec3 GetLocalVertex(uint vi) const { return GetGeometry().GetVertex(vi); }
     const glm::vec3 GetVertex(uint vi, uint instance = 0) const { return Transforms[instance] * glm::vec4(GetLocalVertex(vi), 1); }
     const glm::vec3 GetFaceCenter(uint fi, uint instance = 0) const { return Transforms[instance] * glm::vec4(GetGeometry().GetFaceCenter(fi), 1); }
@@ -37,23 +29,24 @@ struct Mesh {
     virtual void EnableVertexAttributes() const;
 
     virtual void PrepareRender(RenderMode mode) { GetGeometry().PrepareRender(mode); }
-    void Render(RenderMode mode) const;
+    void Render(RenderMode mode) const; // The polygon mode (`GL_POINT` for `RenderMode::Points`) is set by the caller, once per pass.
     virtual void PostRender(RenderMode) {}
 
     void ClearInstances() {
         Transforms.clear();
         Colors.clear();
-        Dirty = true;
+        DirtyTransforms.AddAll();
+        DirtyColors.AddAll();
     }
     void AddInstance(const glm::mat4 &transform, const glm::vec4 &color) {
         Transforms.push_back(transform);
         Colors.push_back(color);
-        Dirty = true;
+        DirtyTransforms.Add(Transforms.size() - 1);
+        DirtyColors.Add(Colors.size() - 1);
     }
 
     void AddInstance(const glm::mat4 &transform) {
         AddInstance(transform, Colors.empty() ? glm::vec4{1} : Colors[0]);
-        Dirty = true;
     }
 
     void SetPosition(const glm::vec3 &position) {
@@ -62,23 +55,26 @@ struct Mesh {
             transform[3][1] = position.y;
             transform[3][2] = position.z;
         }
-        Dirty = true;
+        DirtyTransforms.AddAll();
     }
     void SetTransform(uint instance, const glm::mat4 &transform) {
+        if (Transforms[instance] == transform) return;
         Transforms[instance] = transform;
-        Dirty = true;
+        DirtyTransforms.Add(instance);
     }
     void SetTransform(const glm::mat4 &transform) {
         for (uint instance = 0; instance < Transforms.size(); instance++) SetTransform(instance, transform);
     }
     void SetTransforms(std::vector<glm::mat4> &&transforms) {
         Transforms = std::move(transforms);
-        Dirty = true;
+        DirtyTransforms.AddAll();
     }
 
+    const glm::vec4 &GetColor(uint instance) const { return Colors[instance]; }
     void SetColor(uint instance, const glm::vec4 &color) {
+        if (Colors[instance] == color) return;
         Colors[instance] = color;
-        Dirty = true;
+        DirtyColors.Add(instance);
     }
     void SetColor(const glm::vec4 &color) {
         for (uint instance = 0; instance < Colors.size(); instance++) SetColor(instance, color);
@@ -86,13 +82,18 @@ struct Mesh {
     void SetColors(std::vector<glm::vec4> &&colors) {
         Colors = std::move(colors);
         Colors.resize(Transforms.size());
-        Dirty = true;
+        DirtyColors.AddAll();
     }
     void ClearColors() {
         Colors.clear();
-        Dirty = true;
+        DirtyColors.AddAll();
     }
 
+    // Instance drawn in `HighlightColor` instead of its own color (`-1` for none).
+    // Set through a shader uniform on each draw, so changing it every frame doesn't touch the color buffer.
+    int HighlightedInstance = -1;
+    glm::vec4 HighlightColor{1};
+
 protected:
     GLGeometry Polyhedron;
     Mesh *Parent{nullptr};
@@ -107,5 +108,7 @@ private:
     GLVertexArray VertexArray;
     GLBuffer<glm::vec4, GL_ARRAY_BUFFER> ColorBuffer;
     GLBuffer<glm::mat4, GL_ARRAY_BUFFER> TransformBuffer;
-    mutable bool Dirty{true};
+    // Instance ranges not yet uploaded. Buffers are only reallocated when the number of instances changes.
+    mutable DirtyRange DirtyTransforms, DirtyColors;
+    mutable glm::mat4 BoundParentTransform{1}; // Parent transform the uploaded `AbsoluteTransforms` were computed with.
 };
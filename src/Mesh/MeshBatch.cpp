@@ -0,0 +1,145 @@
+#include "MeshBatch.h"
+
+#include <algorithm>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+void MeshBatch::Generate() {
+    VertexArray.Generate();
+    VertexBuffer.Generate();
+    NormalBuffer.Generate();
+    ColorBuffer.Generate();
+    IndexBuffer.Generate();
+
+    // Same attribute slots as `Mesh`, except colors advance per vertex, and the transform slots are left disabled.
+    VertexArray.Bind();
+    VertexBuffer.Bind();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+    NormalBuffer.Bind();
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+    ColorBuffer.Bind();
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), 0);
+    IndexBuffer.Bind();
+    VertexArray.Unbind();
+}
+
+void MeshBatch::Delete() const {
+    VertexArray.Delete();
+    VertexBuffer.Delete();
+    NormalBuffer.Delete();
+    ColorBuffer.Delete();
+    IndexBuffer.Delete();
+}
+
+void MeshBatch::Add(const Mesh *mesh) {
+    if (!mesh || Contains(mesh)) return;
+
+    Members.emplace_back().Source = mesh;
+    LayoutRenderMode.reset();
+}
+
+void MeshBatch::Remove(const Mesh *mesh) {
+    if (!Contains(mesh)) return;
+
+    std::erase_if(Members, [mesh](const auto &member) { return member.Source == mesh; });
+    LayoutRenderMode.reset();
+}
+
+bool MeshBatch::Contains(const Mesh *mesh) const {
+    return std::any_of(Members.begin(), Members.end(), [mesh](const auto &member) { return member.Source == mesh; });
+}
+
+bool MeshBatch::LayoutChanged(RenderMode mode) const {
+    if (LayoutRenderMode != mode) return true;
+
+    return std::any_of(Members.begin(), Members.end(), [](const auto &member) {
+        const auto &geometry = member.Source->GetGeometry();
+        return member.Transforms.size() != member.Source->NumInstances() ||
+            member.NumVertices != geometry.GetRenderVertices().size() || member.NumIndices != geometry.NumIndices();
+    });
+}
+
+void MeshBatch::UpdateLayout() {
+    Indices.clear();
+    DrawCounts.clear();
+    DrawIndexOffsets.clear();
+    DrawBaseVertices.clear();
+    uint num_vertices = 0;
+    for (auto &member : Members) {
+        const auto &geometry = member.Source->GetGeometry();
+        const uint num_instances = member.Source->NumInstances();
+        member.NumVertices = geometry.GetRenderVertices().size();
+        member.NumIndices = geometry.NumIndices();
+        member.FirstVertex = num_vertices;
+        member.Transforms.resize(num_instances);
+        member.Colors.resize(num_instances);
+        if (num_instances == 0 || member.NumIndices == 0) continue;
+
+        const auto *index_offset = reinterpret_cast<const void *>(Indices.size() * sizeof(uint));
+        const auto indices = geometry.GetRenderIndices();
+        Indices.insert(Indices.end(), indices.begin(), indices.end());
+        for (uint i = 0; i < num_instances; ++i) {
+            DrawCounts.push_back(member.NumIndices);
+            DrawIndexOffsets.push_back(index_offset);
+            DrawBaseVertices.push_back(member.FirstVertex + i * member.NumVertices);
+        }
+        num_vertices += num_instances * member.NumVertices;
+    }
+    Vertices.resize(num_vertices);
+    Normals.resize(num_vertices);
+    Colors.resize(num_vertices);
+    DirtyIndices.AddAll();
+}
+
+void MeshBatch::UpdateInstances(Member &member, bool all) {
+    if (member.NumIndices == 0) return;
+
+    const auto *mesh = member.Source;
+    const auto &geometry = mesh->GetGeometry();
+    const auto vertices = geometry.GetRenderVertices(), normals = geometry.GetRenderNormals();
+    for (uint i = 0; i < member.Transforms.size(); ++i) {
+        const uint begin = member.FirstVertex + i * member.NumVertices, end = begin + member.NumVertices;
+        if (const auto transform = mesh->GetWorldTransform(i); all || transform != member.Transforms[i]) {
+            member.Transforms[i] = transform;
+            const glm::mat3 normal_transform = glm::inverseTranspose(glm::mat3{transform});
+            for (uint v = 0; v < member.NumVertices; ++v) {
+                Vertices[begin + v] = transform * glm::vec4{vertices[v], 1};
+                Normals[begin + v] = v < normals.size() ? normal_transform * normals[v] : glm::vec3{0};
+            }
+            DirtyVertices.Add(begin, end);
+            DirtyNormals.Add(begin, end);
+        }
+        if (const auto &color = int(i) == mesh->HighlightedInstance ? mesh->HighlightColor : mesh->GetColor(i); all || color != member.Colors[i]) {
+            member.Colors[i] = color;
+            std::fill(Colors.begin() + begin, Colors.begin() + end, color);
+            DirtyColors.Add(begin, end);
+        }
+    }
+}
+
+void MeshBatch::Render(RenderMode mode) {
+    const bool layout_changed = LayoutChanged(mode);
+    if (layout_changed) {
+        UpdateLayout();
+        LayoutRenderMode = mode;
+    }
+    for (auto &member : Members) UpdateInstances(member, layout_changed);
+    if (DrawCounts.empty()) return;
+
+    VertexArray.Bind();
+    if (!DirtyVertices.Empty()) VertexBuffer.Update(Vertices, DirtyVertices);
+    if (!DirtyNormals.Empty()) NormalBuffer.Update(Normals, DirtyNormals);
+    if (!DirtyColors.Empty()) ColorBuffer.Update(Colors, DirtyColors);
+    if (!DirtyIndices.Empty()) IndexBuffer.Update(Indices, DirtyIndices);
+
+    // Disabled attribute arrays read the current generic value, so the per-instance transform slots read the identity.
+    for (uint i = 0; i < 4; ++i) glVertexAttrib4fv(3 + i, &I[i][0]);
+    glMultiDrawElementsBaseVertex(
+        mode == RenderMode::Lines ? GL_LINES : GL_TRIANGLES, DrawCounts.data(), GL_UNSIGNED_INT,
+        DrawIndexOffsets.data(), DrawCounts.size(), DrawBaseVertices.data()
+    );
+    VertexArray.Unbind();
+}
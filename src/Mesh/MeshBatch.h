@@ -0,0 +1,55 @@
+#pragma once
+
+#include <optional>
+
+#include "Mesh.h"
+
+// Small helper meshes (arrows, light markers, listener points, the floor), drawn together with one `glMultiDrawElementsBaseVertex` call.
+// Each member's indices are stored once in a shared index buffer. Each of its instances gets its own copy of the member's vertices
+// in shared vertex buffers, transformed and colored on the CPU, and is drawn as the member's indices offset by a base vertex.
+// (Indirect multi-draw and base instances would avoid the copies, but need GL 4.2+, and macOS stops at 4.1.)
+// Only the vertices of instances whose transform or color changed are rewritten and uploaded.
+// Members' geometry is still prepared through `Mesh::PrepareRender`, and may only change with the render mode.
+struct MeshBatch {
+    void Generate();
+    void Delete() const;
+
+    void Add(const Mesh *);
+    void Remove(const Mesh *);
+    bool Contains(const Mesh *) const;
+
+    // Call after members have prepared for `mode`, with the pass state set.
+    // The transform attributes are set to the identity, and `gl_InstanceID` is 0 for every draw.
+    void Render(RenderMode mode);
+
+private:
+    struct Member {
+        const Mesh *Source = nullptr;
+        uint NumVertices = 0, NumIndices = 0; // Of the render-mode geometry, per instance.
+        uint FirstVertex = 0; // Of the first instance. Instances follow each other.
+        // Last written world transform and color (including the highlight) of each instance.
+        std::vector<glm::mat4> Transforms;
+        std::vector<glm::vec4> Colors;
+    };
+
+    std::vector<Member> Members;
+    std::optional<RenderMode> LayoutRenderMode; // Reset when the layout needs to be rebuilt.
+
+    std::vector<glm::vec3> Vertices, Normals;
+    std::vector<glm::vec4> Colors;
+    std::vector<uint> Indices;
+    DirtyRange DirtyVertices, DirtyNormals, DirtyColors, DirtyIndices;
+    // One draw per instance.
+    std::vector<GLsizei> DrawCounts;
+    std::vector<const void *> DrawIndexOffsets;
+    std::vector<GLint> DrawBaseVertices;
+
+    GLVertexArray VertexArray;
+    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> VertexBuffer, NormalBuffer;
+    GLBuffer<glm::vec4, GL_ARRAY_BUFFER> ColorBuffer;
+    GLBuffer<uint, GL_ELEMENT_ARRAY_BUFFER> IndexBuffer;
+
+    bool LayoutChanged(RenderMode) const;
+    void UpdateLayout(); // Place members' indices and instances in the shared buffers.
+    void UpdateInstances(Member &, bool all); // Write the vertices of (`all`, or changed) instances.
+};
@@ -0,0 +1,204 @@
+#include "ModalModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+ModalModel::ModalModel(Data &&data, MaterialProperties material) : Material(material) {
+    auto owned = std::make_shared<const Data>(std::move(data));
+    TetVertices = owned->TetVertices;
+    Tetrahedra = owned->Tetrahedra;
+    SurfaceTriangles = owned->SurfaceTriangles;
+    SetModes(std::move(owned));
+}
+
+void ModalModel::SetModes(std::shared_ptr<const Data> data) {
+    Frequencies = data->Frequencies;
+    T60s = data->T60s;
+    Gains = data->Gains;
+    ExcitableVertices = data->ExcitableVertices;
+    Storage.push_back(std::move(data));
+}
+
+// Model file layout: A `FileHeader`, followed by these arrays of 4-byte elements, in native byte order:
+// frequencies, T60s, gains, excitable vertices, tet vertices (xyz), tetrahedra (4 indices), surface triangles (3 indices).
+// Every array is 4-byte aligned in the file, so a mapping of it can be viewed in place.
+struct FileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t NumModes, NumExcitePositions, NumTetVertices, NumTetrahedra, NumSurfaceTriangles, Padding;
+    MaterialProperties Material;
+};
+static_assert(sizeof(FileHeader) % 8 == 0);
+
+static constexpr char FileMagic[4]{'M', '2', 'M', 'M'};
+static constexpr uint32_t FileVersion = 1;
+
+template<typename T> static void WriteSpan(std::ofstream &file, std::span<const T> span) {
+    file.write(reinterpret_cast<const char *>(span.data()), span.size_bytes());
+}
+
+std::unique_ptr<ModalModel> ModalModel::Load(const fs::path &path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    const auto bytes = file->Bytes();
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) throw std::runtime_error(std::format("{} is not a modal model file.", path.string()));
+
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.Magic, FileMagic, sizeof(FileMagic)) != 0) throw std::runtime_error(std::format("{} is not a modal model file.", path.string()));
+    if (header.Version != FileVersion) throw std::runtime_error(std::format("Unsupported modal model file version {} in {}.", header.Version, path.string()));
+
+    const size_t modes = header.NumModes, positions = header.NumExcitePositions;
+    const size_t num_elements = modes * 2 + modes * positions + positions +
+        size_t(header.NumTetVertices) * 3 + size_t(header.NumTetrahedra) * 4 + size_t(header.NumSurfaceTriangles) * 3;
+    if (bytes.size() < sizeof(header) + num_elements * 4) throw std::runtime_error(std::format("Modal model file {} is truncated.", path.string()));
+
+    auto model = std::unique_ptr<ModalModel>(new ModalModel());
+    const std::byte *cursor = bytes.data() + sizeof(header);
+    model->Frequencies = TakeSpan<float>(cursor, modes);
+    model->T60s = TakeSpan<float>(cursor, modes);
+    model->Gains = TakeSpan<float>(cursor, modes * positions);
+    model->ExcitableVertices = TakeSpan<int>(cursor, positions);
+    model->TetVertices = TakeSpan<float>(cursor, size_t(header.NumTetVertices) * 3);
+    model->Tetrahedra = TakeSpan<unsigned int>(cursor, size_t(header.NumTetrahedra) * 4);
+    model->SurfaceTriangles = TakeSpan<unsigned int>(cursor, size_t(header.NumSurfaceTriangles) * 3);
+    // Don't let a corrupt file index out of bounds. (Negative indices wrap around to large unsigned ones.)
+    const auto out_of_range = [&](auto indices) {
+        return std::any_of(indices.begin(), indices.end(), [&](auto index) { return uint32_t(index) >= header.NumTetVertices; });
+    };
+    if (out_of_range(model->ExcitableVertices) || out_of_range(model->Tetrahedra) || out_of_range(model->SurfaceTriangles)) {
+        throw std::runtime_error(std::format("Modal model file {} has out-of-range vertex indices.", path.string()));
+    }
+    model->Material = header.Material;
+    model->Storage.push_back(std::move(file));
+    return model;
+}
+
+void ModalModel::Save(const fs::path &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error(std::format("Failed to open {} for writing.", path.string()));
+
+    FileHeader header{
+        .Version = FileVersion,
+        .NumModes = NumModes(),
+        .NumExcitePositions = NumExcitePositions(),
+        .NumTetVertices = uint32_t(TetVertices.size() / 3),
+        .NumTetrahedra = uint32_t(Tetrahedra.size() / 4),
+        .NumSurfaceTriangles = uint32_t(SurfaceTriangles.size() / 3),
+        .Padding = 0,
+        .Material = Material,
+    };
+    std::memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    WriteSpan(file, Frequencies);
+    WriteSpan(file, T60s);
+    WriteSpan(file, Gains);
+    WriteSpan(file, ExcitableVertices);
+    WriteSpan(file, TetVertices);
+    WriteSpan(file, Tetrahedra);
+    WriteSpan(file, SurfaceTriangles);
+    if (!file) throw std::runtime_error(std::format("Failed to write modal model to {}.", path.string()));
+}
+
+// Zwicker & Terhardt's approximation of the Bark (critical band rate) scale.
+static float HzToBark(float hz) { return 13 * std::atan(0.00076f * hz) + 3.5f * std::atan(std::pow(hz / 7500, 2)); }
+static float GainToDb(float gain) { return 20 * std::log10(std::max(std::abs(gain), 1e-12f)); }
+
+// Simple spreading function for a tonal masker: its masking threshold is `MaskerOffsetDb` below its own level,
+// and falls off by `MaskingSlopeBelow` dB/Bark toward lower frequencies and `MaskingSlopeAbove` dB/Bark toward higher ones.
+static constexpr float MaskerOffsetDb = 10, MaskingSlopeBelow = 27, MaskingSlopeAbove = 10;
+
+ModalModel::ReduceReport ModalModel::Reduce(const ReduceSettings &settings) {
+    const unsigned int num_modes = NumModes(), num_positions = NumExcitePositions();
+    ReduceReport report{.InitialModes = num_modes};
+    if (!settings.Enabled || num_modes == 0 || num_positions == 0) return report;
+
+    std::vector<unsigned int> order(num_modes);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](auto a, auto b) { return Frequencies[a] < Frequencies[b]; });
+
+    // Merge runs of modes within `MergeBarks` of the first mode in the run.
+    // The merged mode has the combined energy of the run at each excitation position,
+    // and energy-weighted frequency and T60.
+    std::vector<float> freqs, t60s, weights;
+    std::vector<float> energies; // Per merged mode, per excitation position: `energies[mode * num_positions + excite_pos]`.
+    float run_start_bark = 0;
+    for (unsigned int i = 0; i < num_modes; i++) {
+        const unsigned int mode = order[i];
+        const float bark = HzToBark(Frequencies[mode]);
+        if (i == 0 || bark - run_start_bark >= settings.MergeBarks) {
+            run_start_bark = bark;
+            freqs.push_back(0);
+            t60s.push_back(0);
+            weights.push_back(0);
+            energies.resize(energies.size() + num_positions, 0);
+        }
+        float mode_energy = 0;
+        float *merged_energies = energies.data() + (freqs.size() - 1) * num_positions;
+        for (unsigned int p = 0; p < num_positions; p++) {
+            const float energy = Gain(p, mode) * Gain(p, mode);
+            merged_energies[p] += energy;
+            mode_energy += energy;
+        }
+        // Accumulate weighted sums here, and normalize after the run is complete.
+        const float weight = std::max(mode_energy, 1e-12f);
+        freqs.back() += weight * Frequencies[mode];
+        t60s.back() += weight * T60s[mode];
+        weights.back() += weight;
+    }
+    const unsigned int num_merged = freqs.size();
+    std::vector<float> barks(num_merged);
+    for (unsigned int m = 0; m < num_merged; m++) {
+        freqs[m] /= weights[m];
+        t60s[m] /= weights[m];
+        barks[m] = HzToBark(freqs[m]);
+    }
+    report.MergedModes = num_modes - num_merged;
+
+    // Drop modes that are masked at every excitation position.
+    std::vector<float> levels(energies.size()); // dB
+    for (size_t i = 0; i < energies.size(); i++) levels[i] = GainToDb(std::sqrt(energies[i]));
+    std::vector<bool> keep(num_merged, false);
+    for (unsigned int p = 0; p < num_positions; p++) {
+        float peak_db = -INFINITY;
+        for (unsigned int m = 0; m < num_merged; m++) peak_db = std::max(peak_db, levels[m * num_positions + p]);
+        for (unsigned int m = 0; m < num_merged; m++) {
+            if (keep[m]) continue;
+
+            float threshold_db = peak_db + settings.MaskingThresholdDb;
+            for (unsigned int masker = 0; masker < num_merged; masker++) {
+                if (masker == m) continue;
+                const float delta_barks = barks[m] - barks[masker];
+                const float spread_db = delta_barks >= 0 ? -MaskingSlopeAbove * delta_barks : MaskingSlopeBelow * delta_barks;
+                threshold_db = std::max(threshold_db, levels[masker * num_positions + p] - MaskerOffsetDb + spread_db);
+            }
+            if (levels[m * num_positions + p] >= threshold_db) keep[m] = true;
+        }
+    }
+
+    const unsigned int num_kept = std::count(keep.begin(), keep.end(), true);
+    report.MaskedModes = num_merged - num_kept;
+    if (num_kept == num_modes) return report;
+
+    // Synthesis divides the output by the number of modes, so scale gains to keep the same overall level.
+    const float gain_scale = float(num_kept) / num_modes;
+    Data reduced{.ExcitableVertices = {ExcitableVertices.begin(), ExcitableVertices.end()}};
+    reduced.Gains.resize(num_positions * num_kept);
+    for (unsigned int m = 0, kept_i = 0; m < num_merged; m++) {
+        if (!keep[m]) continue;
+
+        reduced.Frequencies.push_back(freqs[m]);
+        reduced.T60s.push_back(t60s[m]);
+        for (unsigned int p = 0; p < num_positions; p++) reduced.Gains[p * num_kept + kept_i] = gain_scale * std::sqrt(energies[m * num_positions + p]);
+        kept_i++;
+    }
+    SetModes(std::make_shared<const Data>(std::move(reduced)));
+    return report;
+}
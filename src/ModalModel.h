@@ -0,0 +1,74 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Material.h"
+
+namespace fs = std::filesystem;
+
+// Modal audio model of an object: the frequencies and decay times of its vibration modes,
+// and the gain of each mode when excited at each of a set of vertices.
+// Also holds the tetrahedral mesh and material the model was computed from.
+//
+// Model data is read through spans, which either view data owned by the model, or a read-only mapping of a model file.
+// Copies are cheap, and share the underlying data.
+struct ModalModel {
+    // Perceptual reduction (see `Reduce`).
+    struct ReduceSettings {
+        bool Enabled = true;
+        float MergeBarks = 0.1; // Merge modes closer than this, in Bark (critical band) units.
+        float MaskingThresholdDb = -60; // Drop modes below this level, relative to the loudest mode at every excitation position.
+    };
+    struct ReduceReport {
+        unsigned int InitialModes = 0, MergedModes = 0, MaskedModes = 0;
+    };
+
+    // Owned model data.
+    struct Data {
+        std::vector<float> Frequencies, T60s, Gains;
+        std::vector<int> ExcitableVertices;
+        std::vector<float> TetVertices;
+        std::vector<unsigned int> Tetrahedra, SurfaceTriangles;
+    };
+
+    inline static const std::string FileExtension = "m2m";
+
+    ModalModel(Data &&, MaterialProperties);
+
+    // Map a model file written by `Save`. Nothing is read until it's accessed.
+    // Throws `std::runtime_error` if the file isn't a valid model file.
+    static std::unique_ptr<ModalModel> Load(const fs::path &);
+    void Save(const fs::path &) const;
+
+    std::span<const float> Frequencies; // Mode frequencies (Hz), ascending.
+    std::span<const float> T60s; // Time for each mode to decay by 60 dB (s).
+    std::span<const float> Gains; // Mode gains by excitation position: `Gains[excite_pos * NumModes() + mode]`.
+    std::span<const int> ExcitableVertices; // Tet mesh vertex index of each excitation position.
+
+    std::span<const float> TetVertices; // xyz
+    std::span<const unsigned int> Tetrahedra; // 4 vertex indices per tetrahedron.
+    std::span<const unsigned int> SurfaceTriangles; // 3 vertex indices per boundary triangle.
+    MaterialProperties Material;
+
+    unsigned int NumModes() const { return Frequencies.size(); }
+    unsigned int NumExcitePositions() const { return ExcitableVertices.size(); }
+    float Gain(unsigned int excite_pos, unsigned int mode) const { return Gains[excite_pos * NumModes() + mode]; }
+
+    // Remove modes that don't make an audible difference, to reduce synthesis cost:
+    // 1) Merge modes within `MergeBarks` of each other into a single mode with their combined energy.
+    // 2) Drop modes that are masked at every excitation position, either by a louder mode nearby in frequency
+    //    (using a simple spreading function over the Bark scale), or by falling below `MaskingThresholdDb`.
+    // Gains are rescaled so the overall level is unchanged, since synthesis normalizes by the number of modes.
+    ReduceReport Reduce(const ReduceSettings &);
+
+private:
+    ModalModel() = default;
+
+    void SetModes(std::shared_ptr<const Data>);
+
+    // Keeps the data behind the spans alive: owned `Data`, and/or a `MappedFile`.
+    std::vector<std::shared_ptr<const void>> Storage;
+};
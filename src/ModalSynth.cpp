@@ -0,0 +1,233 @@
+#include "ModalSynth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "imgui.h"
+
+static constexpr u32 MaxBlockFrames = 512; // Process in blocks of at most this many frames.
+static constexpr float SilenceThreshold = 1e-5; // -100 dB. Modes with output amplitude below this are culled.
+
+ModalSynth::Parameters ModalSynth::SharedParameters::Load() const {
+    static constexpr auto relaxed = std::memory_order_relaxed;
+    const float gate = Gate.load(std::memory_order_acquire);
+    return {
+        .Source = Source.load(relaxed),
+        .Gate = gate,
+        .HammerHardness = HammerHardness.load(relaxed),
+        .HammerSize = HammerSize.load(relaxed),
+        .Gain = Gain.load(relaxed),
+        .Frequency = Frequency.load(relaxed),
+        .ExcitePos = ExcitePos.load(relaxed),
+        .T60Scale = T60Scale.load(relaxed),
+    };
+}
+
+void ModalSynth::SharedParameters::Store(const Parameters &params) {
+    static constexpr auto relaxed = std::memory_order_relaxed;
+    Source.store(params.Source, relaxed);
+    HammerHardness.store(params.HammerHardness, relaxed);
+    HammerSize.store(params.HammerSize, relaxed);
+    Gain.store(params.Gain, relaxed);
+    Frequency.store(params.Frequency, relaxed);
+    ExcitePos.store(params.ExcitePos, relaxed);
+    T60Scale.store(params.T60Scale, relaxed);
+    Gate.store(params.Gate, std::memory_order_release);
+}
+
+ModalSynth::ModalSynth(std::shared_ptr<const ModalModel> model, u32 sample_rate) : Model(std::move(model)), SampleRate(sample_rate) {
+    const u32 num_modes = Model->NumModes();
+    Modes.assign(num_modes, {});
+    ActiveModes.reserve(num_modes);
+    Excitation.assign(MaxBlockFrames, 0);
+    Params.ExcitePos = std::max(0, int(Model->NumExcitePositions() - 1) / 2);
+    Latched = Params.Load();
+    UpdateCoefficients();
+}
+
+void ModalSynth::SetSampleRate(u32 sample_rate) {
+    SampleRate = sample_rate;
+    UpdateCoefficients();
+}
+
+void ModalSynth::UpdateCoefficients() {
+    const auto &model = *Model;
+    const u32 num_modes = model.NumModes();
+    if (num_modes == 0 || model.NumExcitePositions() == 0) return;
+
+    const float sample_rate = SampleRate, nyquist = sample_rate / 2;
+    const u32 excite_pos = std::clamp(Latched.ExcitePos, 0, int(model.NumExcitePositions()) - 1);
+    for (u32 i = 0; i < num_modes; i++) {
+        // Same as Faust's `pm.modeFilter`, with frequencies scaled relative to the fundamental.
+        const float freq = Latched.Frequency * model.Frequencies[i] / model.Frequencies[0];
+        const float t60 = Latched.T60Scale * model.T60s[i];
+        const float w = 2 * std::numbers::pi_v<float> * freq / sample_rate;
+        const float r = std::pow(0.001f, 1 / (t60 * sample_rate));
+        const float sin_w = std::sin(w);
+        auto &mode = Modes[i];
+        mode.CosW = std::cos(w);
+        mode.InvSinW2 = 1 / std::max(sin_w * sin_w, 1e-6f);
+        mode.A1 = -2 * r * mode.CosW;
+        mode.A2 = r * r;
+        mode.Gain = freq < nyquist - 1 ? model.Gain(excite_pos, i) / num_modes : 0;
+    }
+    Coefficients = Latched;
+}
+
+void ModalSynth::Latch() {
+    Latched = Params.Load();
+    if (Latched.Frequency != Coefficients.Frequency || Latched.T60Scale != Coefficients.T60Scale || Latched.ExcitePos != Coefficients.ExcitePos) {
+        UpdateCoefficients();
+    }
+}
+
+// Same as the Faust instrument's `hammer`: A triangular envelope (`en.ar(att,att,trig)`) applied to white noise,
+// through a third-order Butterworth lowpass filter (`fi.lowpass(3,ctoff)`).
+void ModalSynth::StartHammer() {
+    const float attack_seconds = (1 - Latched.HammerHardness) * 0.01 + 0.001;
+    HammerAttackFrames = std::max(1u, u32(attack_seconds * SampleRate));
+    HammerFrame = 0;
+    HammerActive = true;
+
+    const float cutoff = (1 - Latched.HammerSize) * 9500 + 500;
+    const float k = std::tan(std::numbers::pi_v<float> * std::min(cutoff, SampleRate * 0.49f) / SampleRate);
+    LowpassB0 = k / (1 + k);
+    LowpassA1 = (k - 1) / (k + 1);
+    const float norm = 1 / (1 + k + k * k); // Q = 1
+    BiquadB0 = k * k * norm;
+    BiquadA1 = 2 * (k * k - 1) * norm;
+    BiquadA2 = (1 - k + k * k) * norm;
+    LpX1 = LpY1 = BqX1 = BqX2 = BqY1 = BqY2 = 0;
+}
+
+bool ModalSynth::FillExcitation(const float *in, u32 frame_count) {
+    if (Params.Source.load(std::memory_order_relaxed) == 1) {
+        float peak = 0;
+        for (u32 i = 0; i < frame_count; i++) {
+            Excitation[i] = in[i];
+            peak = std::max(peak, std::abs(in[i]));
+        }
+        return peak > SilenceThreshold;
+    }
+    if (!HammerActive) return false;
+
+    const u32 envelope_frames = 2 * HammerAttackFrames;
+    for (u32 i = 0; i < frame_count; i++, HammerFrame++) {
+        if (HammerFrame >= envelope_frames) {
+            std::fill(Excitation.begin() + i, Excitation.begin() + frame_count, 0.f);
+            HammerActive = false;
+            break;
+        }
+        const float envelope = HammerFrame < HammerAttackFrames ?
+            float(HammerFrame) / HammerAttackFrames :
+            float(envelope_frames - HammerFrame) / HammerAttackFrames;
+        NoiseState = NoiseState * 1103515245u + 12345u; // Same generator as Faust's `no.noise`.
+        const float x = envelope * float(int(NoiseState)) / 2147483647.f;
+
+        const float lp = LowpassB0 * (x + LpX1) - LowpassA1 * LpY1;
+        LpX1 = x;
+        LpY1 = lp;
+        const float bq = BiquadB0 * (lp + 2 * BqX1 + BqX2) - BiquadA1 * BqY1 - BiquadA2 * BqY2;
+        BqX2 = BqX1;
+        BqX1 = lp;
+        BqY2 = BqY1;
+        BqY1 = bq;
+        Excitation[i] = bq;
+    }
+    return true;
+}
+
+void ModalSynth::ActivateModes() {
+    for (u32 i = 0; i < Modes.size(); i++) {
+        auto &mode = Modes[i];
+        if (!mode.Active && mode.Gain != 0) {
+            mode.Active = true;
+            ActiveModes.push_back(i); // Never reallocates, since capacity is reserved for all modes.
+        }
+    }
+}
+
+void ModalSynth::Process(const float *in, float *out, u32 frame_count, bool triggered) {
+    const float gate_value = Params.Gate.load(std::memory_order_acquire);
+    const bool gate = gate_value != 0;
+    if (gate || triggered) Latch();
+    if (triggered || (gate && PrevGate == 0)) StartHammer();
+    PrevGate = gate_value;
+
+    const float gain = Params.Gain.load(std::memory_order_relaxed);
+    const float *x = Excitation.data();
+    for (u32 offset = 0; offset < frame_count; offset += MaxBlockFrames) {
+        const u32 block_frames = std::min(MaxBlockFrames, frame_count - offset);
+        const bool excited = FillExcitation(in + offset, block_frames);
+        if (excited) {
+            ActivateModes();
+        } else if (ActiveModes.empty()) {
+            X1 = X2 = 0;
+            continue; // Nothing is sounding.
+        } else {
+            std::fill_n(Excitation.begin(), block_frames, 0.f);
+        }
+
+        // Iterate backwards so culled modes can be swap-removed.
+        for (u32 active_i = ActiveModes.size(); active_i-- > 0;) {
+            auto &mode = Modes[ActiveModes[active_i]];
+            // Resonator: y[n] = x[n] - x[n-2] - a1*y[n-1] - a2*y[n-2]
+            const float a1 = mode.A1, a2 = mode.A2, mode_gain = mode.Gain * gain;
+            float x1 = X1, x2 = X2, y1 = mode.Y1, y2 = mode.Y2;
+            for (u32 i = 0; i < block_frames; i++) {
+                const float y = x[i] - x2 - a1 * y1 - a2 * y2;
+                out[offset + i] += mode_gain * y;
+                x2 = x1;
+                x1 = x[i];
+                y2 = y1;
+                y1 = y;
+            }
+            mode.Y1 = y1;
+            mode.Y2 = y2;
+            if (excited) continue;
+
+            // Squared amplitude of the (slowly decaying) sinusoid passing through the last two outputs.
+            const float amplitude_squared = (y1 * y1 + y2 * y2 - 2 * mode.CosW * y1 * y2) * mode.InvSinW2;
+            if (amplitude_squared * mode_gain * mode_gain < SilenceThreshold * SilenceThreshold) {
+                mode.Y1 = mode.Y2 = 0;
+                mode.Active = false;
+                ActiveModes[active_i] = ActiveModes.back();
+                ActiveModes.pop_back();
+            }
+        }
+        X2 = block_frames > 1 ? x[block_frames - 2] : X1;
+        X1 = x[block_frames - 1];
+    }
+    NumActiveModes = ActiveModes.size();
+}
+
+using namespace ImGui;
+
+void ModalSynth::RenderParams() {
+    // Edit a copy, and only publish it if something changed.
+    auto params = Params.Load();
+    bool changed = false;
+    TextUnformatted("Excitation source");
+    changed |= RadioButton("Hammer", &params.Source, 0);
+    SameLine();
+    changed |= RadioButton("Audio input", &params.Source, 1);
+
+    Button("gate");
+    if (IsItemActivated()) Params.Gate = 1;
+    else if (IsItemDeactivated()) Params.Gate = 0;
+    if (IsItemHovered()) SetTooltip("When excitation source is 'Hammer', excites the vertex. With any excitation source, applies the current parameters.");
+
+    changed |= SliderFloat("hammerHardness", &params.HammerHardness, 0, 1);
+    changed |= SliderFloat("hammerSize", &params.HammerSize, 0, 1);
+    changed |= SliderFloat("gain", &params.Gain, 0, 0.5, "%.3f", ImGuiSliderFlags_Logarithmic);
+    changed |= SliderFloat("Frequency", &params.Frequency, 60, 8000, "%.0f", ImGuiSliderFlags_Logarithmic);
+    changed |= SliderInt("exPos", &params.ExcitePos, 0, std::max(0, int(Model->NumExcitePositions()) - 1));
+    changed |= SliderFloat("t60", &params.T60Scale, 0.1, 10, "%.2f", ImGuiSliderFlags_Logarithmic);
+    if (changed) {
+        params.Gate = Params.Gate; // Keep any change made by the gate button above.
+        Params.Store(params);
+    }
+
+    Text("Active modes: %u/%u", GetNumActiveModes(), Model->NumModes());
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "ModalModel.h"
+
+using u32 = unsigned int;
+
+// Native modal synthesizer, playing a `ModalModel` the same way as the Faust instrument generated by
+// `Audio::FaustState::GenerateModelInstrumentDsp`: A bank of two-pole resonators, excited by a filtered noise burst
+// ("hammer") or by the audio input.
+//
+// Tracks the amplitude envelope of each mode, and stops computing modes once they decay below audibility.
+// When all modes are inactive and there is no excitation, processing a block costs next to nothing.
+// Modes are reactivated on the next excitation.
+struct ModalSynth {
+    // Parameters, with the same defaults & ranges as the Faust instrument's controls.
+    struct Parameters {
+        int Source = 0; // 0: Hammer, 1: Audio input
+        float Gate = 0; // The hammer strikes when this changes from zero to nonzero.
+        float HammerHardness = 0.9, HammerSize = 0.3;
+        float Gain = 0.1;
+        float Frequency = 220; // Fundamental frequency. Other modes are scaled by the same amount.
+        int ExcitePos = 0;
+        float T60Scale = 1;
+    };
+
+    // `Parameters`, set on the UI thread and read on the audio thread.
+    // `Gate` is stored with release ordering (and loaded with acquire ordering), so an excitation's
+    // other parameters (e.g. `ExcitePos`) are visible by the time its gate is.
+    // The rest are independent values, so they're relaxed.
+    struct SharedParameters {
+        SharedParameters() { Store(Parameters{}); } // Defaults from `Parameters`.
+
+        Parameters Load() const;
+        void Store(const Parameters &);
+
+        std::atomic<int> Source, ExcitePos;
+        std::atomic<float> Gate, HammerHardness, HammerSize, Gain, Frequency, T60Scale;
+    };
+
+    // Allocates all state, so construct on a non-real-time thread.
+    ModalSynth(std::shared_ptr<const ModalModel>, u32 sample_rate);
+
+    // Mix `frame_count` frames into `out`, given the (mono) device input.
+    // `triggered` forces a hammer strike, for excitations shorter than a block.
+    void Process(const float *in, float *out, u32 frame_count, bool triggered);
+
+    u32 GetSampleRate() const { return SampleRate; }
+    void SetSampleRate(u32); // Only call while not processing.
+
+    bool IsIdle() const { return NumActiveModes == 0 && !HammerActive; }
+    u32 GetNumActiveModes() const { return NumActiveModes; }
+    const ModalModel &GetModel() const { return *Model; }
+
+    void RenderParams(); // Render parameter controls.
+
+    SharedParameters Params;
+
+private:
+    void UpdateCoefficients(); // Recompute resonator coefficients from the latched parameters. Doesn't allocate.
+    void Latch(); // Sample-and-hold the parameters, like the Faust instrument's `ba.sAndH(gate)`.
+    void StartHammer();
+    bool FillExcitation(const float *in, u32 frame_count); // Returns `false` if the excitation is silent.
+    void ActivateModes();
+
+    struct Mode {
+        float A1, A2; // Resonator feedback coefficients.
+        float CosW, InvSinW2; // Used to estimate the amplitude envelope from the resonator state.
+        float Gain; // Output gain for the latched excitation position, normalized by the number of modes.
+        float Y1, Y2; // Resonator state.
+        bool Active;
+    };
+
+    std::shared_ptr<const ModalModel> Model;
+    u32 SampleRate;
+
+    std::vector<Mode> Modes;
+    std::vector<u32> ActiveModes; // Indices of modes that are still sounding. Capacity is reserved for all modes.
+    std::atomic<u32> NumActiveModes = 0; // Copied from `ActiveModes.size()` for reading off the audio thread.
+
+    // Latched parameters.
+    Parameters Latched, Coefficients; // `Coefficients` holds the parameters `Modes` were last computed for.
+    float PrevGate = 0;
+
+    // Excitation state.
+    std::vector<float> Excitation; // One block of the excitation signal.
+    float X1 = 0, X2 = 0; // Excitation history.
+    bool HammerActive = false;
+    u32 HammerFrame = 0, HammerAttackFrames = 1; // Position in, and half-length of, the triangular hammer envelope.
+    unsigned int NoiseState = 0;
+    float LowpassB0 = 0, LowpassA1 = 0; // First-order section.
+    float BiquadB0 = 0, BiquadA1 = 0, BiquadA2 = 0; // Second-order section.
+    float LpX1 = 0, LpY1 = 0, BqX1 = 0, BqX2 = 0, BqY1 = 0, BqY2 = 0; // Lowpass filter state.
+};
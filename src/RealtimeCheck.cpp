@@ -0,0 +1,136 @@
+#include "RealtimeCheck.h"
+
+#ifdef REALTIME_SAFETY_CHECK
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <execinfo.h>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace RealtimeCheck {
+static thread_local bool InScope = false; // `true` while the current thread holds a `Scope`.
+static thread_local bool Reporting = false; // Reporting may itself allocate, so don't report recursively.
+static std::atomic<unsigned int> ViolationCount = 0;
+
+static void Report(const char *what) {
+    if (!InScope || Reporting) return;
+
+    Reporting = true;
+    ++ViolationCount;
+    static constexpr int MaxFrames = 32;
+    void *frames[MaxFrames];
+    const int num_frames = backtrace(frames, MaxFrames);
+    fprintf(stderr, "[RealtimeCheck] %s on the audio thread. Backtrace:\n", what);
+    backtrace_symbols_fd(frames, num_frames, STDERR_FILENO);
+    Reporting = false;
+}
+
+Scope::Scope() { InScope = true; }
+Scope::~Scope() { InScope = false; }
+
+void Init() {
+    // The first `backtrace` call lazily loads the unwinder, which allocates. Get that out of the way now.
+    void *frame;
+    backtrace(&frame, 1);
+}
+
+unsigned int NumViolations() { return ViolationCount; }
+
+void ReportLock() {
+#ifndef __GLIBC__ // glibc builds already report it from `pthread_mutex_lock`.
+    Report("Mutex lock");
+#endif
+}
+} // namespace RealtimeCheck
+
+// Interpose allocation and locking entry points in the executable, forwarding to the real implementations.
+#ifdef __GLIBC__
+// glibc supports replacing `malloc` & co. by defining them in the executable, and exposes its own implementations.
+// This catches C allocations (miniaudio, Faust) as well as `operator new`, which is implemented with `malloc`.
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void __libc_free(void *);
+int __pthread_mutex_lock(pthread_mutex_t *);
+
+void *malloc(size_t size) {
+    RealtimeCheck::Report("malloc");
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+    RealtimeCheck::Report("calloc");
+    return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, size_t size) {
+    RealtimeCheck::Report("realloc");
+    return __libc_realloc(ptr, size);
+}
+void free(void *ptr) {
+    if (ptr) RealtimeCheck::Report("free");
+    __libc_free(ptr);
+}
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    RealtimeCheck::Report("pthread_mutex_lock");
+    return __pthread_mutex_lock(mutex);
+}
+}
+#else
+// Other platforms don't let us replace `malloc` without dynamic-linker tricks,
+// so only C++ allocations are checked, by replacing every replaceable global `operator new`/`operator delete`.
+// (Standard libraries don't reliably forward the other variants to the basic ones, e.g. libc++'s aligned `new`.)
+static void *Allocate(size_t size, const char *what) {
+    RealtimeCheck::Report(what);
+    return std::malloc(size ? size : 1);
+}
+static void *AllocateAligned(size_t size, std::align_val_t alignment, const char *what) {
+    RealtimeCheck::Report(what);
+    void *ptr = nullptr;
+    const size_t align = std::max(size_t(alignment), sizeof(void *));
+    return posix_memalign(&ptr, align, size ? size : 1) == 0 ? ptr : nullptr;
+}
+static void Deallocate(void *ptr, const char *what) noexcept {
+    if (ptr) RealtimeCheck::Report(what);
+    std::free(ptr);
+}
+
+void *operator new(size_t size) {
+    if (void *ptr = Allocate(size, "operator new")) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+    if (void *ptr = Allocate(size, "operator new[]")) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return Allocate(size, "operator new"); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return Allocate(size, "operator new[]"); }
+void *operator new(size_t size, std::align_val_t alignment) {
+    if (void *ptr = AllocateAligned(size, alignment, "operator new")) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+    if (void *ptr = AllocateAligned(size, alignment, "operator new[]")) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return AllocateAligned(size, alignment, "operator new"); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return AllocateAligned(size, alignment, "operator new[]"); }
+
+void operator delete(void *ptr) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr) noexcept { Deallocate(ptr, "operator delete[]"); }
+void operator delete(void *ptr, size_t) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr, size_t) noexcept { Deallocate(ptr, "operator delete[]"); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { Deallocate(ptr, "operator delete[]"); }
+void operator delete(void *ptr, std::align_val_t) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { Deallocate(ptr, "operator delete[]"); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { Deallocate(ptr, "operator delete[]"); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { Deallocate(ptr, "operator delete"); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { Deallocate(ptr, "operator delete[]"); }
+#endif
+
+#endif // REALTIME_SAFETY_CHECK
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+
+// Debug checks for real-time safety of the audio callback thread.
+// When built with `REALTIME_SAFETY_CHECK` (CMake option of the same name), heap allocations and mutex acquisitions
+// made by a thread while it holds a `RealtimeCheck::Scope` are reported to stderr, along with a backtrace.
+// Otherwise, everything here compiles away to nothing.
+//
+// Coverage depends on the platform:
+// - glibc: All `malloc`/`free` family calls (so C and C++ allocations), and all `pthread_mutex_lock` calls.
+// - Others (macOS): Only C++ allocations (every replaceable `operator new`/`operator delete`), and only locks
+//   of `RealtimeCheck::Mutex`es. C allocations (e.g. in miniaudio or Faust) and other locks go unnoticed.
+namespace RealtimeCheck {
+#ifdef REALTIME_SAFETY_CHECK
+inline constexpr bool Enabled = true;
+
+// Marks the current thread as running real-time code for the lifetime of the scope.
+struct Scope {
+    Scope();
+    ~Scope();
+};
+
+void Init(); // Call from a non-real-time thread before starting the audio device.
+unsigned int NumViolations(); // Total number of violations reported since startup.
+
+void ReportLock(); // Report a lock taken in a scope, on platforms where locks aren't interposed.
+
+// A `std::mutex` whose locks are checked on every platform.
+struct Mutex : std::mutex {
+    void lock() {
+        ReportLock();
+        std::mutex::lock();
+    }
+};
+#else
+inline constexpr bool Enabled = false;
+
+struct Scope {
+    Scope() {}
+};
+
+using Mutex = std::mutex;
+
+inline void Init() {}
+inline unsigned int NumViolations() { return 0; }
+#endif
+} // namespace RealtimeCheck
@@ -6,7 +6,6 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include "GLCanvas.h"
-#include "Geometry/Primitive/Cylinder.h"
 #include "Geometry/Primitive/Rect.h"
 #include "Geometry/Primitive/Sphere.h"
 #include "Shader/ShaderProgram.h"
@@ -21,7 +20,13 @@ inline static const std::string
     Projection = "projection",
     CameraView = "camera_view",
     LineWidth = "line_width",
-    GridLinesColor = "grid_lines_color";
+    GridLinesColor = "grid_lines_color",
+    HighlightInstance = "highlight_instance",
+    HighlightColor = "highlight_color",
+    Model = "model",
+    PointSize = "point_size",
+    NormalLength = "normal_length",
+    Color = "color";
 } // namespace UniformName
 
 Scene::Scene() {
@@ -61,16 +66,22 @@ Scene::Scene() {
     namespace un = UniformName;
     static const fs::path ShaderDir = fs::path("res") / "shaders";
     static const Shader
-        TransformVertexShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex.glsl", {un::Projection, un::CameraView}},
-        TransformVertexLinesShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex_lines.glsl", {un::Projection, un::CameraView}},
+        TransformVertexShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex.glsl", {un::Projection, un::CameraView, un::HighlightInstance, un::HighlightColor}},
+        TransformVertexLinesShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex_lines.glsl", {un::Projection, un::CameraView, un::HighlightInstance, un::HighlightColor}},
         LinesGeometryShader{GL_GEOMETRY_SHADER, ShaderDir / "lines_geom.glsl", {un::LineWidth}},
         FragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "fragment.glsl", {un::NumLights, un::AmbientColor, un::DiffuseColor, un::SpecularColor, un::ShininessFactor}},
         GridLinesVertexShader{GL_VERTEX_SHADER, ShaderDir / "grid_lines_vertex.glsl", {un::Projection, un::CameraView}},
-        GridLinesFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "grid_lines_fragment.glsl", {}};
+        GridLinesFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "grid_lines_fragment.glsl", {}},
+        PickVertexShader{GL_VERTEX_SHADER, ShaderDir / "pick_vertex.glsl", {un::Projection, un::CameraView, un::Model, un::PointSize}},
+        PickFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "pick_fragment.glsl", {}},
+        NormalIndicatorVertexShader{GL_VERTEX_SHADER, ShaderDir / "normal_indicator_vertex.glsl", {un::Projection, un::CameraView, un::Model, un::NormalLength}},
+        ColorFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "color_fragment.glsl", {un::Color}};
 
     MainShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&TransformVertexShader, &FragmentShader});
     LinesShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&TransformVertexLinesShader, &LinesGeometryShader, &FragmentShader});
     GridLinesShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&GridLinesVertexShader, &GridLinesFragmentShader});
+    PickShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&PickVertexShader, &PickFragmentShader});
+    NormalIndicatorShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&NormalIndicatorVertexShader, &ColorFragmentShader});
 
     CurrShaderProgram = MainShaderProgram.get();
     CurrShaderProgram->Use();
@@ -81,23 +92,41 @@ Scene::Scene() {
 
     GLuint light_block_index = glGetUniformBlockIndex(CurrShaderProgram->Id, "LightBlock");
     glBindBufferBase(GL_UNIFORM_BUFFER, light_block_index, LightBufferId);
+
+    HelperMeshes.Generate();
+    LightPoints = std::make_unique<Mesh>(Sphere{0.1});
+    LightPoints->Generate();
+    ShowLightPoints.resize(Lights.size(), false);
+    UpdateLightPoints();
+    AddMesh(LightPoints.get(), true);
 }
 
 Scene::~Scene() {
     glDeleteBuffers(1, &LightBufferId);
+    LightPoints->Delete();
+    HelperMeshes.Delete();
+}
+
+void Scene::UpdateLightPoints() {
+    LightPoints->ClearInstances();
+    for (size_t i = 0; i < Lights.size(); i++) {
+        if (ShowLightPoints[i]) LightPoints->AddInstance(glm::translate(I, glm::vec3{Lights[i].Position}), Lights[i].Color);
+    }
 }
 
-void Scene::AddMesh(Mesh *mesh) {
+void Scene::AddMesh(Mesh *mesh, bool batched) {
     if (!mesh) return;
     if (std::find(Meshes.begin(), Meshes.end(), mesh) != Meshes.end()) return;
 
     Meshes.push_back(mesh);
+    if (batched) HelperMeshes.Add(mesh);
 }
 
 void Scene::RemoveMesh(const Mesh *mesh) {
     if (!mesh) return;
 
     Meshes.erase(std::remove(Meshes.begin(), Meshes.end(), mesh), Meshes.end());
+    HelperMeshes.Remove(mesh);
 }
 
 void Scene::SetCameraDistance(float distance) {
@@ -141,19 +170,69 @@ void Scene::Render() {
         glUniform1f(CurrShaderProgram->GetUniform(un::LineWidth), LineWidth);
     }
 
+    // Update the picked vertex before meshes prepare (and use `PickedVertex`).
+    // GPU picks are read back from a previous frame's pick pass.
+    if (!window_hovered || !PickMesh) {
+        PickedVertex = -1;
+    } else if (GpuPicking) {
+        PickedVertex = int(Canvas->GetPickedId()) - 1;
+    } else {
+        const auto mouse = io.MousePos - GetCursorScreenPos(); // Relative to the canvas image, which is drawn at the cursor.
+        PickedVertex = ScreenProjection::FindNearestWithin(
+            PickMesh->GetGeometry().GetProjectionPoints(), CameraProjection * CameraView * PickMesh->GetTransform(),
+            {content_region.x, content_region.y}, {mouse.x, mouse.y}, PickRadius
+        );
+    }
+
     for (auto *mesh : Meshes) mesh->PrepareRender(ActiveRenderMode);
 
     // auto start_time = std::chrono::high_resolution_clock::now();
     if (ActiveRenderMode == RenderMode::Points) glPointSize(PointRadius);
 
-    for (const auto *mesh : Meshes) mesh->Render(ActiveRenderMode);
+    // Pass state is set once, and per-mesh uniforms only when they change.
+    glPolygonMode(GL_FRONT_AND_BACK, ActiveRenderMode == RenderMode::Points ? GL_POINT : GL_FILL);
+    const GLint highlight_instance_location = CurrShaderProgram->GetUniform(un::HighlightInstance);
+    const GLint highlight_color_location = CurrShaderProgram->GetUniform(un::HighlightColor);
+    std::optional<int> bound_highlight_instance;
+    std::optional<glm::vec4> bound_highlight_color;
+    for (const auto *mesh : Meshes) {
+        if (mesh->NumInstances() == 0 || mesh->GetGeometry().NumIndices() == 0 || HelperMeshes.Contains(mesh)) continue;
+
+        if (bound_highlight_instance != mesh->HighlightedInstance) {
+            bound_highlight_instance = mesh->HighlightedInstance;
+            glUniform1i(highlight_instance_location, mesh->HighlightedInstance);
+        }
+        // The color doesn't matter without a highlighted instance.
+        if (mesh->HighlightedInstance >= 0 && bound_highlight_color != mesh->HighlightColor) {
+            bound_highlight_color = mesh->HighlightColor;
+            glUniform4fv(highlight_color_location, 1, &mesh->HighlightColor[0]);
+        }
+        mesh->Render(ActiveRenderMode);
+    }
+    // Highlights are baked into the batch's vertex colors.
+    if (bound_highlight_instance != -1) glUniform1i(highlight_instance_location, -1);
+    HelperMeshes.Render(ActiveRenderMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     for (auto *mesh : Meshes) mesh->PostRender(ActiveRenderMode);
     // std::cout << "Draw time: " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start_time).count() << "us" << std::endl;
 
-    if (NormalIndicator) {
-        MainShaderProgram->Use();
-        NormalIndicator->PrepareRender(RenderMode::Flat);
-        NormalIndicator->Render(RenderMode::Flat);
+    if (NormalMode != NormalIndicatorMode::None) {
+        static const float ScaleFactor = 0.025; // Of the mesh's bounding box diagonal length, at `NormalIndicatorLength = 1`.
+
+        NormalIndicatorShaderProgram->Use();
+        glUniformMatrix4fv(NormalIndicatorShaderProgram->GetUniform(un::Projection), 1, GL_FALSE, &CameraProjection[0][0]);
+        glUniformMatrix4fv(NormalIndicatorShaderProgram->GetUniform(un::CameraView), 1, GL_FALSE, &CameraView[0][0]);
+        glUniform4fv(NormalIndicatorShaderProgram->GetUniform(un::Color), 1, &NormalIndicatorColor[0]);
+        for (const auto *mesh : Meshes) {
+            if (mesh->NumInstances() == 0) continue;
+
+            const auto [min, max] = mesh->ComputeBounds();
+            const auto model = mesh->GetWorldTransform();
+            glUniformMatrix4fv(NormalIndicatorShaderProgram->GetUniform(un::Model), 1, GL_FALSE, &model[0][0]);
+            glUniform1f(NormalIndicatorShaderProgram->GetUniform(un::NormalLength), NormalIndicatorLength * ScaleFactor * glm::distance(min, max));
+            if (NormalMode == NormalIndicatorMode::Vertex) mesh->GetGeometry().RenderVertexNormals();
+            else mesh->GetGeometry().RenderFaceNormals();
+        }
     }
 
     if (Grid) {
@@ -169,6 +248,19 @@ void Scene::Render() {
         glDisable(GL_BLEND);
     }
 
+    if (PickMesh && window_hovered && GpuPicking) {
+        // Draw the pick mesh's vertices as discs into the ID buffer, and start reading back the ID under the mouse.
+        Canvas->BeginPick();
+        PickShaderProgram->Use();
+        glUniformMatrix4fv(PickShaderProgram->GetUniform(un::Projection), 1, GL_FALSE, &CameraProjection[0][0]);
+        glUniformMatrix4fv(PickShaderProgram->GetUniform(un::CameraView), 1, GL_FALSE, &CameraView[0][0]);
+        glUniformMatrix4fv(PickShaderProgram->GetUniform(un::Model), 1, GL_FALSE, &PickMesh->GetTransform()[0][0]);
+        glUniform1f(PickShaderProgram->GetUniform(un::PointSize), 2 * PickRadius);
+        PickMesh->GetGeometry().RenderPoints();
+        const auto mouse = io.MousePos - GetCursorScreenPos(); // Relative to the canvas image, which is drawn at the cursor.
+        Canvas->EndPick(int(mouse.x), int(content_region.y - mouse.y)); // GL pixel rows are bottom-up.
+    }
+
     // Render the scene to an OpenGl texture and display it (without changing the cursor position).
     const auto &cursor = GetCursorPos();
     unsigned int texture_id = Canvas->Render();
@@ -224,27 +316,6 @@ void Scene::RenderGizmoDebug() {
     Checkbox("Bound sizing", &ShowBounds);
 }
 
-void Scene::UpdateNormalIndicators() {
-    static const float ScaleFactor = 0.025;
-
-    NormalIndicator->ClearInstances();
-    if (NormalMode == NormalIndicatorMode::None) return;
-
-    for (const auto *mesh : Meshes) {
-        if (mesh->NumInstances() == 0) continue;
-
-        const auto [min, max] = mesh->ComputeBounds();
-        const glm::vec3 scale = glm::vec3{ScaleFactor, NormalIndicatorLength, ScaleFactor} * glm::distance(min, max) * ScaleFactor;
-        const uint num_points = NormalMode == NormalIndicatorMode::Vertex ? mesh->NumVertices() : mesh->NumFaces();
-        for (uint i = 0; i < num_points; i++) {
-            const glm::vec3 point = NormalMode == NormalIndicatorMode::Vertex ? mesh->GetVertex(i) : mesh->GetFaceCenter(i);
-            const glm::vec3 normal = NormalMode == NormalIndicatorMode::Vertex ? mesh->GetVertexNormal(i) : mesh->GetFaceNormal(i);
-            const glm::mat4 transform = glm::scale(glm::translate(I, point) * glm::mat4_cast(glm::rotation(Up, normal)), scale);
-            NormalIndicator->AddInstance(transform, NormalIndicatorColor);
-        }
-    }
-}
-
 void Scene::RenderConfig() {
     if (BeginTabBar("SceneConfig")) {
         if (BeginTabItem("Geometries")) {
@@ -284,6 +355,8 @@ void Scene::RenderConfig() {
             if (ActiveRenderMode == RenderMode::Points) {
                 SliderFloat("Point radius", &PointRadius, 0.1, 10, "%.2f", ImGuiSliderFlags_Logarithmic);
             }
+            Checkbox("GPU vertex picking", &GpuPicking);
+            if (IsItemHovered()) SetTooltip("Find the hovered vertex with an ID buffer pass on the GPU (one frame behind the mouse),\ninstead of projecting every vertex on the CPU.");
             SeparatorText("Normal indicator mode");
             int normal_mode = int(NormalMode);
             bool normal_mode_changed = RadioButton("None", &normal_mode, int(NormalIndicatorMode::None));
@@ -291,25 +364,10 @@ void Scene::RenderConfig() {
             normal_mode_changed |= RadioButton("Face normals", &normal_mode, int(NormalIndicatorMode::Face));
             SameLine();
             normal_mode_changed |= RadioButton("Vertex normals", &normal_mode, int(NormalIndicatorMode::Vertex));
-            if (NormalIndicatorMode(normal_mode) != NormalIndicatorMode::None && !NormalIndicator) {
-                NormalIndicator = std::make_unique<Mesh>(Cylinder{}, Meshes[0]);
-                NormalIndicator->Generate();
-            } else if (NormalIndicatorMode(normal_mode) == NormalIndicatorMode::None && NormalIndicator) {
-                NormalIndicator->Delete();
-                NormalIndicator.reset();
-            }
-
             if (normal_mode_changed) NormalMode = NormalIndicatorMode(normal_mode);
-            if (NormalIndicator) {
-                if (normal_mode_changed) UpdateNormalIndicators();
-                if (ColorEdit3("Normal color", &NormalIndicatorColor[0])) {
-                    for (uint i = 0; i < NormalIndicator->NumInstances(); i++) {
-                        NormalIndicator->SetColor(i, NormalIndicatorColor);
-                    }
-                }
-                if (SliderFloat("Normal length", &NormalIndicatorLength, 0.1f, 2.f)) {
-                    UpdateNormalIndicators();
-                }
+            if (NormalMode != NormalIndicatorMode::None) {
+                ColorEdit3("Normal color", &NormalIndicatorColor[0]);
+                SliderFloat("Normal length", &NormalIndicatorLength, 0.1f, 2.f);
             }
             EndTabItem();
         }
@@ -348,25 +406,15 @@ void Scene::RenderConfig() {
                 Separator();
                 PushID(i);
                 Text("Light %d", int(i + 1));
-                bool show_lights = LightPoints.contains(i);
-                if (Checkbox("Show", &show_lights)) {
-                    if (show_lights) {
-                        LightPoints[i] = std::make_unique<Mesh>(Sphere{0.1});
-                        LightPoints[i]->Generate();
-                        LightPoints[i]->SetColor(Lights[i].Color);
-                        LightPoints[i]->SetPosition(Lights[i].Position);
-                        AddMesh(LightPoints[i].get());
-                    } else {
-                        RemoveMesh(LightPoints[i].get());
-                        LightPoints.erase(i);
-                    }
-                }
-                if (SliderFloat3("Position", &Lights[i].Position[0], -8, 8)) {
-                    if (LightPoints.contains(i)) LightPoints[i]->SetPosition(Lights[i].Position);
-                }
-                if (ColorEdit3("Color", &Lights[i].Color[0]) && LightPoints.contains(i)) {
-                    LightPoints[i]->SetColor(Lights[i].Color);
+                bool show_light = ShowLightPoints[i];
+                bool light_points_changed = false;
+                if (Checkbox("Show", &show_light)) {
+                    ShowLightPoints[i] = show_light;
+                    light_points_changed = true;
                 }
+                light_points_changed |= SliderFloat3("Position", &Lights[i].Position[0], -8, 8) && show_light;
+                light_points_changed |= ColorEdit3("Color", &Lights[i].Color[0]) && show_light;
+                if (light_points_changed) UpdateLightPoints();
                 PopID();
             }
             EndTabItem();
@@ -1,14 +1,13 @@
 #pragma once
 
 #include <functional>
-#include <unordered_map>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imgui.h"
 
 #include "ImGuizmo.h"
 
-#include "Mesh/Mesh.h"
+#include "Mesh/MeshBatch.h"
 
 struct GLCanvas;
 struct ShaderProgram;
@@ -24,9 +23,12 @@ struct Scene {
     Scene();
     ~Scene();
 
-    void AddMesh(Mesh *);
+    // `batched` meshes are drawn together with the other batched meshes, in one multi-draw call (see `MeshBatch`).
+    // Use it for small helper meshes, not for meshes with many vertices.
+    void AddMesh(Mesh *, bool batched = false);
     void RemoveMesh(const Mesh *);
 
+    // Other meshes are drawn with one (instanced) draw call each, and all share the same pass state.
     void Render();
     void RenderConfig();
     void RenderGizmoDebug();
@@ -57,16 +59,27 @@ struct Scene {
     inline static float Bounds[6] = {-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
     inline static RenderMode ActiveRenderMode = RenderMode::Flat;
 
-private:
-    void UpdateNormalIndicators();
+    // Vertex picking on the GPU: The vertex of `PickMesh` (active geometry) within `PickRadius` pixels of the mouse,
+    // nearest to the camera, or -1 for none.
+    // `PickedVertex` is updated at the start of `Render`, before meshes are prepared, from the previous frame's pick pass.
+    const Mesh *PickMesh = nullptr;
+    float PickRadius = 5;
+    int PickedVertex = -1;
+    bool GpuPicking = true; // Otherwise, vertices are projected on the CPU each frame (no latency, but cost scales with the vertex count).
 
-    std::unique_ptr<ShaderProgram> MainShaderProgram, LinesShaderProgram, GridLinesShaderProgram;
+private:
+    std::unique_ptr<ShaderProgram> MainShaderProgram, LinesShaderProgram, GridLinesShaderProgram, PickShaderProgram, NormalIndicatorShaderProgram;
     ShaderProgram *CurrShaderProgram = nullptr;
-    std::unordered_map<uint, std::unique_ptr<Mesh>> LightPoints; // For visualizing light positions. Key is `Lights` index.
+    // For visualizing light positions: One instance per shown light, in `Lights` order.
+    std::unique_ptr<Mesh> LightPoints;
+    std::vector<bool> ShowLightPoints; // Per `Lights` index.
+    MeshBatch HelperMeshes; // Batched members of `Meshes`.
+
+    void UpdateLightPoints();
 
     std::unique_ptr<GLCanvas> Canvas;
     std::unique_ptr<Mesh> Grid;
-    std::unique_ptr<Mesh> NormalIndicator; // Instanced mesh for displaying normals.
+    // Normals are drawn as lines, generated in a vertex shader from each mesh's vertex or face normal buffers.
     glm::vec4 NormalIndicatorColor = {0, 0, 1, 1};
     float NormalIndicatorLength = 1.f; // This is normalized by a factor based on the mesh's bounding box diagonal length.
 
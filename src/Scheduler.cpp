@@ -0,0 +1,286 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Scheduler {
+static constexpr int NumPriorities = 2;
+
+struct Task {
+    Task(std::function<void()> &&work, Priority priority) : Work(std::move(work)), QueuePriority(priority) {}
+
+    std::function<void()> Work;
+    const Priority QueuePriority;
+    std::atomic<int> PendingDependencies = 1; // Starts at one, so the task can't start while dependencies are being registered.
+
+    std::mutex Mutex; // Guards the members below.
+    std::condition_variable DoneCondition;
+    bool Done = false;
+    std::exception_ptr Exception;
+    std::vector<TaskHandle> Dependents;
+};
+
+namespace {
+struct Queue {
+    std::mutex Mutex;
+    std::deque<TaskHandle> Tasks[NumPriorities];
+};
+
+thread_local int ThreadIndex = -1; // Index of the current scheduler thread, or -1 for other threads.
+// Leave a core for the UI thread. `hardware_concurrency` returns 0 when it can't be determined.
+uint PoolSize() {
+    const uint hc = std::thread::hardware_concurrency();
+    return std::max(2u, hc > 1 ? hc - 1 : 1u);
+}
+
+struct Pool {
+    Pool() : Queues(PoolSize()) {
+        Threads.reserve(Queues.size());
+        for (uint i = 0; i < Queues.size(); ++i) Threads.emplace_back([this, i] { Run(i); });
+    }
+    // Finishes all queued tasks.
+    ~Pool() {
+        {
+            std::lock_guard lock{Mutex};
+            Stopping = true;
+        }
+        WorkAvailable.notify_all();
+        for (auto &thread : Threads) thread.join();
+    }
+
+    void Enqueue(TaskHandle task) {
+        const uint queue_index = ThreadIndex >= 0 ? ThreadIndex : NextQueue++ % Queues.size();
+        auto &queue = Queues[queue_index];
+        {
+            std::lock_guard lock{queue.Mutex};
+            queue.Tasks[int(task->QueuePriority)].push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock{Mutex}; // Don't let a thread miss the notification between checking for work and waiting.
+            NumQueued++;
+        }
+        WorkAvailable.notify_one();
+    }
+
+    // Own tasks are taken newest-first (they're likely still in cache), and others' oldest-first.
+    // Only tasks with priority at least `max_priority` are considered.
+    TaskHandle FindTask(int thread_index, Priority max_priority = Priority::Normal) {
+        for (int p = 0; p <= int(max_priority); ++p) {
+            if (thread_index >= 0) {
+                auto &queue = Queues[thread_index];
+                std::lock_guard lock{queue.Mutex};
+                if (auto &tasks = queue.Tasks[p]; !tasks.empty()) {
+                    auto task = std::move(tasks.back());
+                    tasks.pop_back();
+                    NumQueued--;
+                    return task;
+                }
+            }
+            for (uint i = 0; i < Queues.size(); ++i) {
+                if (int(i) == thread_index) continue;
+                auto &queue = Queues[i];
+                std::lock_guard lock{queue.Mutex};
+                if (auto &tasks = queue.Tasks[p]; !tasks.empty()) {
+                    auto task = std::move(tasks.front());
+                    tasks.pop_front();
+                    NumQueued--;
+                    return task;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void Execute(const TaskHandle &task) {
+        bool skip;
+        {
+            std::lock_guard lock{task->Mutex};
+            skip = bool(task->Exception); // A dependency failed.
+        }
+        if (!skip) {
+            try {
+                task->Work();
+            } catch (...) {
+                std::lock_guard lock{task->Mutex};
+                task->Exception = std::current_exception();
+            }
+        }
+        task->Work = nullptr; // Release captured state now, rather than when the last handle goes away.
+
+        std::vector<TaskHandle> dependents;
+        std::exception_ptr exception;
+        {
+            std::lock_guard lock{task->Mutex};
+            task->Done = true;
+            dependents.swap(task->Dependents);
+            exception = task->Exception;
+        }
+        task->DoneCondition.notify_all();
+        for (auto &dependent : dependents) {
+            if (exception) {
+                std::lock_guard lock{dependent->Mutex};
+                if (!dependent->Exception) dependent->Exception = exception;
+            }
+            if (--dependent->PendingDependencies == 0) Enqueue(std::move(dependent));
+        }
+    }
+
+    void Run(uint thread_index) {
+        ThreadIndex = thread_index;
+        while (true) {
+            if (auto task = FindTask(thread_index)) {
+                Execute(task);
+                continue;
+            }
+
+            std::unique_lock lock{Mutex};
+            if (NumQueued > 0) continue;
+            if (Stopping) break;
+
+            WorkAvailable.wait(lock);
+        }
+    }
+
+    std::vector<Queue> Queues; // One per thread.
+    std::vector<std::thread> Threads;
+    std::atomic<uint> NextQueue = 0; // Round-robin queue for tasks submitted from other threads.
+
+    std::mutex Mutex; // Guards the members below, and pairs with `WorkAvailable`.
+    std::condition_variable WorkAvailable;
+    std::atomic<uint> NumQueued = 0; // Decremented without the lock, so a waiting thread may wake spuriously, but never miss work.
+    bool Stopping = false;
+};
+
+Pool &GetPool() {
+    static Pool pool;
+    return pool;
+}
+} // namespace
+
+TaskHandle Submit(std::function<void()> work, Priority priority, const std::vector<TaskHandle> &dependencies) {
+    auto task = std::make_shared<Task>(std::move(work), priority);
+    for (const auto &dependency : dependencies) {
+        if (!dependency) continue;
+
+        std::lock_guard lock{dependency->Mutex};
+        if (dependency->Done) {
+            if (dependency->Exception) {
+                std::lock_guard task_lock{task->Mutex};
+                if (!task->Exception) task->Exception = dependency->Exception;
+            }
+        } else {
+            task->PendingDependencies++;
+            dependency->Dependents.push_back(task);
+        }
+    }
+    if (--task->PendingDependencies == 0) GetPool().Enqueue(task);
+    return task;
+}
+
+bool IsDone(const TaskHandle &task) {
+    std::lock_guard lock{task->Mutex};
+    return task->Done;
+}
+
+void Wait(const TaskHandle &task) {
+    if (ThreadIndex >= 0) {
+        // Help out rather than block, so waiting on tasks from tasks can't deadlock the pool.
+        // Only take short high-priority tasks, so a waiting thread isn't held up by an unrelated long job.
+        auto &pool = GetPool();
+        while (!IsDone(task)) {
+            if (auto other = pool.FindTask(ThreadIndex, Priority::High)) pool.Execute(other);
+            else std::this_thread::yield();
+        }
+    } else {
+        std::unique_lock lock{task->Mutex};
+        task->DoneCondition.wait(lock, [&] { return task->Done; });
+    }
+    std::lock_guard lock{task->Mutex};
+    if (task->Exception) std::rethrow_exception(task->Exception);
+}
+
+namespace {
+// Shared by the caller of `ParallelFor` and its helper tasks.
+// Chunks are claimed from `NextChunk`, so whoever gets there first runs them, and helper tasks that start
+// after all chunks are claimed return without touching `F` (which may be gone by then).
+struct ParallelForState {
+    const std::function<void(uint, uint)> *F;
+    uint Begin, End, ChunkSize, NumChunks;
+    std::atomic<uint> NextChunk = 0;
+    std::atomic<bool> Failed = false; // Remaining chunks are skipped after one throws.
+
+    std::mutex Mutex; // Guards the members below.
+    std::condition_variable DoneCondition;
+    uint CompletedChunks = 0;
+    std::exception_ptr Exception;
+
+    bool IsDone() {
+        std::lock_guard lock{Mutex};
+        return CompletedChunks == NumChunks;
+    }
+
+    // Run chunks until none are left to claim.
+    void Run() {
+        for (uint chunk; (chunk = NextChunk.fetch_add(1)) < NumChunks;) {
+            std::exception_ptr exception;
+            if (!Failed) {
+                const uint chunk_begin = Begin + chunk * ChunkSize;
+                try {
+                    (*F)(chunk_begin, std::min(End, chunk_begin + ChunkSize));
+                } catch (...) {
+                    exception = std::current_exception();
+                    Failed = true;
+                }
+            }
+            bool done;
+            {
+                std::lock_guard lock{Mutex};
+                if (exception && !Exception) Exception = exception;
+                done = ++CompletedChunks == NumChunks;
+            }
+            if (done) DoneCondition.notify_all();
+        }
+    }
+};
+} // namespace
+
+void ParallelFor(uint begin, uint end, const std::function<void(uint, uint)> &f, uint min_chunk) {
+    if (end <= begin) return;
+
+    const uint count = end - begin;
+    const uint num_chunks = std::clamp((count + min_chunk - 1) / std::max(min_chunk, 1u), 1u, NumThreads() * 4);
+    if (num_chunks == 1) return f(begin, end);
+
+    auto state = std::make_shared<ParallelForState>();
+    state->F = &f;
+    state->Begin = begin;
+    state->End = end;
+    state->ChunkSize = (count + num_chunks - 1) / num_chunks;
+    state->NumChunks = (count + state->ChunkSize - 1) / state->ChunkSize;
+    // Helpers only claim chunks, so there's no point in having more of them than threads.
+    const uint num_helpers = std::min(state->NumChunks - 1, NumThreads());
+    for (uint i = 0; i < num_helpers; ++i) Submit([state] { state->Run(); }, Priority::High);
+
+    // Run chunks here too, taking back any the pool hasn't started, and only wait for chunks already in progress.
+    state->Run();
+    if (ThreadIndex >= 0) {
+        auto &pool = GetPool();
+        while (!state->IsDone()) {
+            if (auto other = pool.FindTask(ThreadIndex, Priority::High)) pool.Execute(other);
+            else std::this_thread::yield();
+        }
+    } else {
+        std::unique_lock lock{state->Mutex};
+        state->DoneCondition.wait(lock, [&] { return state->CompletedChunks == state->NumChunks; });
+    }
+    std::lock_guard lock{state->Mutex};
+    if (state->Exception) std::rethrow_exception(state->Exception);
+}
+
+uint NumThreads() { return GetPool().Threads.size(); }
+} // namespace Scheduler
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+using uint = unsigned int;
+
+// Process-wide task scheduler, shared by all background work (tet generation, modal analysis, DSP compilation,
+// and parallel geometry kernels), instead of each subsystem spawning its own threads.
+// (Audio device updates run on their own thread, so they are never delayed by long jobs.)
+//
+// A fixed pool of threads, each with its own deque per priority. Threads run their own newest tasks first,
+// and steal the oldest tasks of other threads when out of work. Higher-priority tasks always run first.
+// Tasks can depend on other tasks, and only become runnable once all their dependencies complete.
+// If a dependency throws, its dependents are skipped and complete with the same exception.
+namespace Scheduler {
+enum class Priority {
+    High, // Short tasks someone is waiting on (e.g. `ParallelFor` chunks).
+    Normal, // User-initiated jobs.
+};
+
+struct Task;
+using TaskHandle = std::shared_ptr<Task>;
+
+TaskHandle Submit(std::function<void()> work, Priority = Priority::Normal, const std::vector<TaskHandle> &dependencies = {});
+
+bool IsDone(const TaskHandle &);
+// Block until the task completes, rethrowing its exception, if any.
+// When called from a scheduler thread, runs other high-priority tasks while waiting.
+void Wait(const TaskHandle &);
+
+// Call `f(chunk_begin, chunk_end)` over `[begin, end)` split into chunks of at least `min_chunk` elements, in parallel.
+// The calling thread runs chunks too, including any the pool hasn't started yet, so it only ever waits
+// for chunks already running on other threads.
+void ParallelFor(uint begin, uint end, const std::function<void(uint, uint)> &f, uint min_chunk = 1024);
+
+uint NumThreads();
+} // namespace Scheduler
@@ -1,19 +1,30 @@
 #include "Worker.h"
 
+#include <iostream>
+
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imgui.h"
 #include "imspinner.h"
 
 using namespace ImGui;
 
-void Worker::Launch(const std::function<void()> &work) {
+void Worker::Launch(std::function<void()> work, const std::vector<Scheduler::TaskHandle> &dependencies) {
+    if (Working) return;
+
     OpenPopup(WorkingMessage.c_str());
-    if (Thread.joinable()) Thread.join();
-    Thread = std::thread([&]() {
-        Working = true;
-        work();
-        Working = false;
-    });
+    Progress.Reset();
+    Canceled = false;
+    Working = true; // Set before submitting, so `Render` can't see the work as done before it starts.
+    Task = Scheduler::Submit(
+        [this, work = std::move(work)] {
+            try {
+                work();
+            } catch (const JobCanceled &) {
+                Canceled = true;
+            }
+        },
+        Scheduler::Priority::Normal, dependencies
+    );
 }
 
 void Worker::Launch() {
@@ -32,13 +43,28 @@ bool Worker::Render() {
     SetNextWindowSize(GetMainViewport()->Size / 4);
     if (BeginPopupModal(WorkingMessage.c_str(), nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
         const auto &ws = GetWindowSize();
-        const float spinner_size = std::min(ws.x, ws.y) / 2;
-        SetCursorPos((ws - ImVec2{spinner_size, spinner_size}) / 2 + ImVec2(0, GetTextLineHeight()));
+        const float spinner_size = std::min(ws.x, ws.y) / 3;
+        SetCursorPosX((ws.x - spinner_size) / 2);
         ImSpinner::SpinnerMultiFadeDots(WorkingMessage.c_str(), spinner_size / 2, 3);
-        if (!Working) {
-            Thread.join();
+
+        const auto [stage, fraction] = Progress.Get();
+        if (!stage.empty()) TextUnformatted(stage.c_str());
+        if (fraction >= 0) ProgressBar(fraction, {-FLT_MIN, 0});
+        if (Progress.IsCancelRequested()) {
+            TextUnformatted("Canceling after the current stage...");
+        } else if (Button("Cancel")) {
+            Progress.RequestCancel();
+        }
+
+        if (Working && Scheduler::IsDone(Task)) {
+            Working = false;
             CloseCurrentPopup();
-            completed = true;
+            try {
+                Scheduler::Wait(Task);
+                completed = !Canceled;
+            } catch (const std::exception &e) {
+                std::cerr << "Error: " << WorkingMessage << ' ' << e.what() << '\n';
+            }
         }
         EndPopup();
     }
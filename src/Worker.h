@@ -1,18 +1,66 @@
 #pragma once
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <string_view>
-#include <thread>
+
+#include "Scheduler.h"
+
+// Thrown by `JobProgress::ThrowIfCanceled` to unwind a canceled job.
+struct JobCanceled : std::exception {
+    const char *what() const noexcept override { return "Job canceled"; }
+};
+
+// Shared between a running job and the UI: The job reports its current stage and progress,
+// and checks for cancellation requests between (or within) stages.
+// Cancellation is cooperative, since long-running library calls (TetGen, mesh2faust) can't be interrupted.
+struct JobProgress {
+    // `fraction` is the fraction of the whole job completed, in [0, 1], or negative if unknown.
+    void SetStage(std::string_view stage, float fraction = -1) {
+        std::lock_guard lock{Mutex};
+        Stage = stage;
+        Fraction = fraction;
+    }
+    std::pair<std::string, float> Get() const {
+        std::lock_guard lock{Mutex};
+        return {Stage, Fraction};
+    }
+
+    void RequestCancel() { CancelRequested = true; }
+    bool IsCancelRequested() const { return CancelRequested; }
+    void ThrowIfCanceled() const {
+        if (CancelRequested) throw JobCanceled{};
+    }
+
+    void Reset() {
+        SetStage("");
+        CancelRequested = false;
+    }
+
+private:
+    mutable std::mutex Mutex;
+    std::string Stage;
+    float Fraction = -1;
+    std::atomic<bool> CancelRequested = false;
+};
 
 struct Worker {
     Worker(std::string_view launch_label, std::string_view working_message, std::function<void()> work = {})
         : LaunchLabel(launch_label), WorkingMessage(working_message), Work(work) {}
 
     ~Worker() {
-        if (Thread.joinable()) Thread.join();
+        Progress.RequestCancel();
+        if (Task) {
+            try {
+                Scheduler::Wait(Task);
+            } catch (...) {}
+        }
     }
 
-    bool Render(); // Returns `true` if the work completed.
+    bool Render(); // Returns `true` if the work completed (and wasn't canceled).
     void RenderLauncher(const std::function<void()> &work);
     void RenderLauncher(std::string_view launch_label) {
         LaunchLabel = launch_label;
@@ -20,11 +68,14 @@ struct Worker {
     }
     void RenderLauncher() { RenderLauncher(Work); }
 
+    // Submit the work to the scheduler, to run after `dependencies` complete.
+    // Does nothing if the previous work is still running, so it never blocks.
     void Launch();
-    void Launch(const std::function<void()> &work);
+    void Launch(std::function<void()> work, const std::vector<Scheduler::TaskHandle> &dependencies = {});
 
-    std::thread Thread;
+    Scheduler::TaskHandle Task; // The most recently launched work.
     std::string LaunchLabel, WorkingMessage;
     std::function<void()> Work;
-    std::atomic<bool> Working = false;
+    std::atomic<bool> Working = false, Canceled = false;
+    JobProgress Progress; // Work functions report progress and check for cancellation through this.
 };
@@ -15,22 +15,83 @@
 #include "Audio.h"
 #include "Geometry/Primitive/Cuboid.h"
 #include "Mesh/InteractiveMesh.h"
+#include "ModalModel.h"
 #include "Physics.h"
 #include "RealImpact.h"
 #include "Window.h"
-#include "Worker.h"
 
 #include "Scene.h"
 
 static WindowsState Windows;
 
 static std::unique_ptr<Scene> MainScene;
-static std::unique_ptr<InteractiveMesh> MainMesh;
+// Each mesh plays its own voice. The selected mesh is shown in the mesh, profile and audio model windows,
+// and is the one hovered and excited with the mouse.
+static std::vector<std::unique_ptr<InteractiveMesh>> InteractiveMeshes;
+static size_t SelectedMeshIndex = 0;
 static std::unique_ptr<Physics> MainPhysics;
 static std::unique_ptr<Mesh> Floor;
 
-static Worker DspGenerator{"Generate DSP code", "Generating DSP code..."};
-static string GeneratedDsp; // The most recently generated DSP code.
+static InteractiveMesh *GetSelectedMesh() {
+    return SelectedMeshIndex < InteractiveMeshes.size() ? InteractiveMeshes[SelectedMeshIndex].get() : nullptr;
+}
+
+static void SelectMesh(size_t index) {
+    SelectedMeshIndex = index;
+    if (auto *mesh = GetSelectedMesh()) mesh->Select();
+}
+
+// Place the mesh at `index` to the right of the one before it, so they don't overlap.
+static void PlaceMesh(size_t index) {
+    if (index == 0) return;
+
+    const auto &previous = *InteractiveMeshes[index - 1];
+    auto &mesh = *InteractiveMeshes[index];
+    const auto [previous_min, previous_max] = previous.ComputeBounds();
+    const auto [min, max] = mesh.ComputeBounds();
+    const float previous_right = (previous.GetTransform() * glm::vec4{previous_max, 1}).x;
+    mesh.SetTranslation({previous_right - min.x + 0.1f * glm::distance(min, max), 0, 0});
+}
+
+// Physics bodies refer to the meshes, so adding, replacing or removing a mesh turns physics off.
+// Replaces the selected mesh if `replace` is true, and otherwise adds the new one to the scene.
+static void LoadMesh(const fs::path &file_path, bool replace) {
+    MainPhysics.reset();
+    auto mesh = std::make_unique<InteractiveMesh>(*MainScene, file_path);
+    mesh->Generate();
+    if (replace && GetSelectedMesh()) {
+        InteractiveMeshes[SelectedMeshIndex]->Delete();
+        InteractiveMeshes[SelectedMeshIndex] = std::move(mesh);
+    } else {
+        InteractiveMeshes.push_back(std::move(mesh));
+        SelectedMeshIndex = InteractiveMeshes.size() - 1;
+    }
+    PlaceMesh(SelectedMeshIndex);
+    SelectMesh(SelectedMeshIndex);
+}
+
+static void RemoveSelectedMesh() {
+    if (!GetSelectedMesh()) return;
+
+    MainPhysics.reset();
+    InteractiveMeshes[SelectedMeshIndex]->Delete();
+    InteractiveMeshes.erase(InteractiveMeshes.begin() + SelectedMeshIndex);
+    SelectMesh(SelectedMeshIndex > 0 ? SelectedMeshIndex - 1 : 0);
+}
+
+// Empty if the dialog was canceled.
+static fs::path OpenMeshFileDialog() {
+    nfdchar_t *file_path;
+    nfdfilteritem_t filter[] = {{"Mesh object", "obj"}, {"SVG profile", "svg"}};
+    nfdresult_t result = NFD_OpenDialog(&file_path, filter, 2, "res/");
+    if (result == NFD_OKAY) {
+        const fs::path path = file_path;
+        NFD_FreePath(file_path);
+        return path;
+    }
+    if (result != NFD_CANCEL) std::cerr << "Error: " << NFD_GetError() << '\n';
+    return {};
+}
 
 ::Audio Audio{};
 
@@ -135,20 +196,18 @@ int main(int, char **) {
     // IM_ASSERT(font != NULL);
 
     if (!MainScene) MainScene = std::make_unique<Scene>();
-    MainMesh = std::make_unique<InteractiveMesh>(*MainScene, fs::path("res") / "svg" / "bell" / "std.svg");
+    LoadMesh(fs::path("res") / "svg" / "bell" / "std.svg", false);
     // Alternatively, we could initialize with a mesh obj file:
-    // MainMesh = std::make_unique<InteractiveMesh>(*MainScene, fs::path("res") / "obj" / "bell" / "english.obj");
-    // MainMesh = std::make_unique<InteractiveMesh>(*MainScene, fs::path("res") / "obj" / "bunny.obj");
-    // MainMesh = std::make_unique<InteractiveMesh>(*MainScene, fs::path("../../../") / "RealImpact" / "dataset" / "22_Cup" / "preprocessed" / "transformed.obj");
-
-    MainMesh->Generate();
+    // LoadMesh(fs::path("res") / "obj" / "bell" / "english.obj", false);
+    // LoadMesh(fs::path("res") / "obj" / "bunny.obj", false);
+    // LoadMesh(fs::path("../../../") / "RealImpact" / "dataset" / "22_Cup" / "preprocessed" / "transformed.obj", false);
 
     static const float floor_y = -1;
     static const glm::vec3 floor_half_extents = {10, 1, 10};
     Floor = std::make_unique<Mesh>(Cuboid{floor_half_extents});
     Floor->Generate();
     Floor->SetTransform(glm::translate(I, {0, floor_y - floor_half_extents.y, 0}));
-    MainScene->AddMesh(Floor.get());
+    MainScene->AddMesh(Floor.get(), true);
 
     glEnable(GL_DEPTH_TEST);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -173,6 +232,8 @@ int main(int, char **) {
         ImGui_ImplSDL3_NewFrame();
         NewFrame();
 
+        for (auto &mesh : InteractiveMeshes) mesh->UpdateModelBuild();
+
         auto dockspace_id = DockSpaceOverViewport(nullptr, ImGuiDockNodeFlags_PassthruCentralNode);
         if (GetFrameCount() == 1) {
             auto audio_node_id = DockBuilderSplitNode(dockspace_id, ImGuiDir_Down, 0.3f, nullptr, &dockspace_id);
@@ -193,25 +254,59 @@ int main(int, char **) {
         }
         if (BeginMainMenuBar()) {
             if (BeginMenu("File")) {
+                auto *selected_mesh = GetSelectedMesh();
                 if (MenuItem("Load mesh", nullptr)) {
+                    if (const auto file_path = OpenMeshFileDialog(); !file_path.empty()) LoadMesh(file_path, true);
+                    selected_mesh = GetSelectedMesh();
+                }
+                if (IsItemHovered()) SetTooltip("Replace the selected mesh.");
+                if (MenuItem("Add mesh", nullptr)) {
+                    if (const auto file_path = OpenMeshFileDialog(); !file_path.empty()) LoadMesh(file_path, false);
+                    selected_mesh = GetSelectedMesh();
+                }
+                if (MenuItem("Remove mesh", nullptr, false, selected_mesh != nullptr)) {
+                    RemoveSelectedMesh();
+                    selected_mesh = GetSelectedMesh();
+                }
+                Separator();
+                if (MenuItem("Export mesh as obj", nullptr, false, selected_mesh != nullptr)) {
+                    nfdchar_t *save_path;
+                    nfdfilteritem_t filter[] = {{"Mesh object", "obj"}};
+                    nfdresult_t result = NFD_SaveDialog(&save_path, filter, 1, nullptr, "res/");
+                    if (result == NFD_OKAY) {
+                        selected_mesh->Save(save_path);
+                        NFD_FreePath(save_path);
+                    } else if (result != NFD_CANCEL) {
+                        std::cerr << "Error: " << NFD_GetError() << '\n';
+                    }
+                }
+                Separator();
+                if (MenuItem("Load modal model", nullptr, false, selected_mesh != nullptr)) {
                     nfdchar_t *file_path;
-                    nfdfilteritem_t filter[] = {{"Mesh object", "obj"}, {"SVG profile", "svg"}};
-                    nfdresult_t result = NFD_OpenDialog(&file_path, filter, 2, "res/");
+                    nfdfilteritem_t filter[] = {{"Modal model", ModalModel::FileExtension.c_str()}};
+                    nfdresult_t result = NFD_OpenDialog(&file_path, filter, 1, "res/");
                     if (result == NFD_OKAY) {
-                        MainMesh->Delete();
-                        MainMesh = std::make_unique<InteractiveMesh>(*MainScene, file_path);
-                        MainMesh->Generate();
+                        try {
+                            selected_mesh->LoadModel(file_path);
+                        } catch (const std::runtime_error &e) {
+                            std::cerr << "Error: " << e.what() << '\n';
+                        }
                         NFD_FreePath(file_path);
                     } else if (result != NFD_CANCEL) {
                         std::cerr << "Error: " << NFD_GetError() << '\n';
                     }
                 }
-                if (MenuItem("Export mesh as obj", nullptr, false, MainMesh != nullptr)) {
+                const auto model = selected_mesh ? Audio::FaustState::GetModel(selected_mesh->GetVoiceId()) : nullptr;
+                if (MenuItem("Export modal model", nullptr, false, model != nullptr)) {
                     nfdchar_t *save_path;
-                    nfdfilteritem_t filter[] = {{"Mesh object", "obj"}};
+                    nfdfilteritem_t filter[] = {{"Modal model", ModalModel::FileExtension.c_str()}};
                     nfdresult_t result = NFD_SaveDialog(&save_path, filter, 1, nullptr, "res/");
                     if (result == NFD_OKAY) {
-                        MainMesh->Save(save_path);
+                        try {
+                            model->Save(save_path);
+                        } catch (const std::runtime_error &e) {
+                            std::cerr << "Error: " << e.what() << '\n';
+                        }
                         NFD_FreePath(save_path);
                     } else if (result != NFD_CANCEL) {
                         std::cerr << "Error: " << NFD_GetError() << '\n';
@@ -248,10 +343,20 @@ int main(int, char **) {
         }
         if (Windows.MeshControls.Visible) {
             Begin(Windows.MeshControls.Name, &Windows.MeshControls.Visible);
-            if (MainMesh == nullptr) {
+            if (auto *selected_mesh = GetSelectedMesh(); selected_mesh == nullptr) {
                 Text("No mesh has been loaded.");
             } else {
-                MainMesh->RenderConfig();
+                if (InteractiveMeshes.size() > 1 && BeginCombo("Selected mesh", selected_mesh->FilePath.filename().string().c_str())) {
+                    for (size_t i = 0; i < InteractiveMeshes.size(); ++i) {
+                        PushID(int(i));
+                        const bool is_selected = i == SelectedMeshIndex;
+                        if (Selectable(InteractiveMeshes[i]->FilePath.filename().string().c_str(), is_selected)) SelectMesh(i);
+                        if (is_selected) SetItemDefaultFocus();
+                        PopID();
+                    }
+                    EndCombo();
+                }
+                GetSelectedMesh()->RenderConfig();
             }
             End();
         }
@@ -262,7 +367,7 @@ int main(int, char **) {
                 if (enable_physics) {
                     MainPhysics = std::make_unique<Physics>();
                     MainPhysics->AddRigidBody(Floor.get(), Physics::BodyType::Static);
-                    MainPhysics->AddRigidBody(MainMesh.get(), Physics::BodyType::Dynamic, true);
+                    for (auto &mesh : InteractiveMeshes) MainPhysics->AddRigidBody(mesh.get(), Physics::BodyType::Dynamic, true);
                 } else {
                     MainPhysics.reset();
                 }
@@ -277,20 +382,18 @@ int main(int, char **) {
 
             MainScene->Render();
             if (MainPhysics) {
-                const auto &collisions = MainPhysics->Tick();
-                if (MainMesh && MainMesh->HasTets()) {
-                    for (const auto &collision : collisions) {
-                        glm::vec3 point;
-                        if (collision.Point1.Body->Mesh == MainMesh.get()) point = collision.Point1.Position;
-                        else if (collision.Point2.Body->Mesh == MainMesh.get()) point = collision.Point2.Position;
-                        else continue;
-
-                        const uint nearest_vertex = MainMesh->GetTets().FindVertextNearestTo(point);
+                // Every interactive mesh has its own voice, so both sides of a collision can sound.
+                for (const auto &collision : MainPhysics->Tick()) {
+                    for (const auto *point : {&collision.Point1, &collision.Point2}) {
+                        auto *mesh = dynamic_cast<InteractiveMesh *>(point->Body->Mesh);
+                        if (!mesh || !mesh->HasTets()) continue;
+
+                        const uint nearest_vertex = mesh->GetTets().FindVertextNearestTo(point->Position);
                         // todo find good scaling
                         // todo release vertex
                         // todo multiple simultaneous vertex triggers (need to modify the DSP)
                         const float amount = std::max(1.f, collision.PenetrationDepth);
-                        MainMesh->TriggerVertex(nearest_vertex, amount);
+                        mesh->TriggerVertex(nearest_vertex, amount);
                     }
                 }
             }
@@ -301,7 +404,7 @@ int main(int, char **) {
             PushStyleVar(ImGuiStyleVar_WindowPadding, {0, 0});
             Begin(Windows.MeshProfile.Name, &Windows.MeshProfile.Visible);
 
-            if (MainMesh != nullptr) MainMesh->RenderProfile();
+            if (auto *selected_mesh = GetSelectedMesh()) selected_mesh->RenderProfile();
             else Text("No mesh has been loaded.");
 
             End();
@@ -316,32 +419,33 @@ int main(int, char **) {
         if (Windows.AudioModel.Visible) {
             Begin(Windows.AudioModel.Name, &Windows.AudioModel.Visible);
 
-            if (BeginTabBar("Audio model")) {
+            auto *selected_mesh = GetSelectedMesh();
+            if (selected_mesh == nullptr) Text("No mesh has been loaded.");
+            else if (BeginTabBar("Audio model")) {
                 if (BeginTabItem("Model")) {
-                    const bool has_tetrahedral_mesh = MainMesh->HasTets();
-                    const bool has_profile = MainMesh->HasProfile();
-                    if (!has_tetrahedral_mesh) BeginDisabled();
-                    const bool generate_dsp = Button("Generate DSP");
-                    if (!has_tetrahedral_mesh) {
-                        SameLine();
-                        TextUnformatted("Run |Mesh Controls|->|Mesh|->|Generate tetrahedral mesh|.");
-                        EndDisabled();
+                    const bool has_tetrahedral_mesh = selected_mesh->HasTets();
+                    const bool has_profile = selected_mesh->HasProfile();
+                    selected_mesh->RenderModelBuild(InteractiveMesh::ModelStage_Synth, "Build model");
+                    Checkbox("Rebuild automatically", &selected_mesh->AutoBuildModel);
+                    if (IsItemHovered()) SetTooltip("Rebuild the affected stages of the model in the background whenever the mesh, tet settings, material, excitation or mode reduction settings change.");
+                    auto &mode_reduction = selected_mesh->ModeReduction;
+                    if (TreeNode("Mode reduction")) {
+                        Checkbox("Merge and drop inaudible modes", &mode_reduction.Enabled);
+                        if (!mode_reduction.Enabled) BeginDisabled();
+                        SliderFloat("Merge distance (Bark)", &mode_reduction.MergeBarks, 0, 0.5, "%.3f");
+                        SliderFloat("Masking threshold (dB)", &mode_reduction.MaskingThresholdDb, -120, 0, "%.0f");
+                        if (!mode_reduction.Enabled) EndDisabled();
+                        TreePop();
                     }
-                    if (!has_profile) BeginDisabled();
-                    if (!has_profile) {
-                        SameLine();
-                        TextUnformatted("Run |File|->|Open mesh| and select an SVG file.");
-                        EndDisabled();
+                    if (selected_mesh->ModeReductionReport) {
+                        const auto &report = *selected_mesh->ModeReductionReport;
+                        const u32 num_removed = report.MergedModes + report.MaskedModes;
+                        Text("Modes: %u (%u removed: %u merged, %u masked)", report.InitialModes - num_removed, num_removed, report.MergedModes, report.MaskedModes);
                     }
-                    if (generate_dsp) {
-                        DspGenerator.Launch([&] {
-                            const string model_dsp = MainMesh->GenerateDsp();
-                            GeneratedDsp = model_dsp.empty() ? "process = _;" : Audio::FaustState::GenerateModelInstrumentDsp(model_dsp, MainMesh->NumExcitableVertices);
-                        });
-                    }
-                    if (DspGenerator.Render()) {
-                        Audio.Faust.Code = GeneratedDsp;
-                        GeneratedDsp = "";
+                    if (const string error = Audio::FaustState::GetError(selected_mesh->GetVoiceId()); !error.empty()) {
+                        TextUnformatted(error.c_str());
+                    } else if (Audio::FaustState::IsRunning(selected_mesh->GetVoiceId())) {
+                        TextUnformatted(Audio::FaustState::IsSuspended(selected_mesh->GetVoiceId()) ? "Voice: suspended (silent)" : "Voice: active");
                     }
                     if (has_tetrahedral_mesh || has_profile) {
                         SeparatorText("Material properties");
@@ -370,7 +474,9 @@ int main(int, char **) {
                     }
                     EndTabItem();
                 }
-                if (!Audio.Faust.Code.empty()) {
+                // The Faust code is only generated once the Faust engine is selected in the controls.
+                const string code = Audio::FaustState::GetCode(selected_mesh->GetVoiceId());
+                if (!code.empty()) {
                     if (BeginTabItem("Code")) {
                         if (Button("Export to file")) {
                             nfdchar_t *save_path;
@@ -379,18 +485,20 @@ int main(int, char **) {
                             if (result == NFD_OKAY) {
                                 // Write the Faust code to the file.
                                 std::ofstream file(save_path);
-                                file << Audio.Faust.Code;
+                                file << code;
                                 file.close();
                                 NFD_FreePath(save_path);
                             } else if (result != NFD_CANCEL) {
                                 std::cerr << "Error: " << NFD_GetError() << '\n';
                             }
                         }
-                        TextUnformatted(Audio.Faust.Code.c_str());
+                        TextUnformatted(code.c_str());
                         EndTabItem();
                     }
+                }
+                if (Audio::FaustState::IsRunning(selected_mesh->GetVoiceId())) {
                     if (BeginTabItem("Control")) {
-                        Audio.Faust.Render();
+                        Audio.Faust.Render(selected_mesh->GetVoiceId());
                         EndTabItem();
                     }
                 }